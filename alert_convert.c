@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/*
+   Converts the collective binary alert log (ddos_detector --mpiio) to
+   alerts.csv rows.  Each alert gets the global verdict of its window;
+   rows are appended, like the coordinator's own CSV logging.
+*/
+
+static int convert_alert_log(const char *input, const char *output)
+{
+    FILE *in = fopen(input, "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", input);
+        return -1;
+    }
+
+    AlertLogHeader h;
+    if (fread(&h, sizeof(AlertLogHeader), 1, in) != 1 ||
+        memcmp(h.magic, ALERT_LOG_MAGIC, sizeof(h.magic)) != 0 ||
+        h.alert_size != (int32_t)sizeof(AlertRecord) ||
+        h.verdict_size != (int32_t)sizeof(VerdictRecord)) {
+        fprintf(stderr, "%s is not an alert log of this build\n", input);
+        fclose(in);
+        return -1;
+    }
+
+    VerdictRecord *verdicts = malloc(sizeof(VerdictRecord) *
+                                     (h.verdict_count > 0 ? h.verdict_count : 1));
+    if (!verdicts ||
+        fread(verdicts, sizeof(VerdictRecord), h.verdict_count, in) !=
+        (size_t)h.verdict_count) {
+        fprintf(stderr, "Truncated verdicts in %s\n", input);
+        free(verdicts);
+        fclose(in);
+        return -1;
+    }
+
+    /* window id -> verdict; ids are small and dense */
+    int max_window = -1;
+    for (long i = 0; i < h.verdict_count; i++) {
+        if (verdicts[i].window_id > max_window) {
+            max_window = verdicts[i].window_id;
+        }
+    }
+    size_t slots = max_window >= 0 ? (size_t)max_window + 1 : 1;
+    long *by_window = malloc(sizeof(long) * slots);
+    FILE *out = fopen(output, "a");
+    if (!by_window || !out) {
+        fprintf(stderr, "Cannot open %s\n", output);
+        if (out) fclose(out);
+        free(by_window);
+        free(verdicts);
+        fclose(in);
+        return -1;
+    }
+    for (int w = 0; w <= max_window; w++) {
+        by_window[w] = -1;
+    }
+    for (long i = 0; i < h.verdict_count; i++) {
+        if (verdicts[i].window_id >= 0) {
+            by_window[verdicts[i].window_id] = i;
+        }
+    }
+
+    long rows = 0;
+    AlertRecord rec;
+    while (rows < h.alert_count && fread(&rec, sizeof(AlertRecord), 1, in) == 1) {
+        Alert alert;
+        char chosen[IP_STR_LEN] = "";
+        alert_log_record(&rec, &alert);
+
+        const VerdictRecord *v = NULL;
+        if (rec.window_id >= 0 && rec.window_id <= max_window &&
+            by_window[rec.window_id] >= 0) {
+            v = &verdicts[by_window[rec.window_id]];
+        }
+        if (v && v->chosen_ip != 0) {
+            ip_from_u32(v->chosen_ip, chosen);
+        }
+        alert_csv_row(out, &alert, v ? v->global_attack : 0, chosen);
+        rows++;
+    }
+
+    fclose(out);
+    free(by_window);
+    free(verdicts);
+    fclose(in);
+
+    printf("Converted %ld alert(s) from %d rank(s), %lld window verdict(s), "
+           "into %s\n", rows, h.ranks, (long long)h.verdict_count, output);
+    if (rows < h.alert_count) {
+        fprintf(stderr, "Truncated alerts in %s: %ld of %lld\n", input,
+                rows, (long long)h.alert_count);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s <alerts.bin> [alerts.csv]\n", argv[0]);
+        printf("Example: %s %s results/metrics/alerts.csv\n", argv[0],
+               ALERT_LOG_PATH);
+        return 1;
+    }
+    const char *output = argc > 2 ? argv[2] : "results/metrics/alerts.csv";
+    return convert_alert_log(argv[1], output) == 0 ? 0 : 1;
+}
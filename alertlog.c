@@ -0,0 +1,232 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Collective binary alert log
+   ============================== */
+/*
+   With --mpiio, each rank keeps the alerts it produced itself as
+   fixed-width AlertRecords, and rank 0 keeps one VerdictRecord per
+   decided window.  Nothing is written per window.  At the end of the
+   run every rank writes its records with one MPI_File_write_at_all:
+
+   AlertLogHeader               rank 0
+   VerdictRecord x verdicts     rank 0
+   AlertRecord x alerts         every rank, in rank order
+
+   A rank's alert offset is the MPI_Exscan prefix of the counts before
+   it, so no rank waits on another's data and rank 0 does not funnel
+   the workers' alerts through its own file handle.  Records are in
+   native byte order; alert_convert turns the file into alerts.csv rows.
+*/
+
+void alert_log_init(AlertLog *log)
+{
+    memset(log, 0, sizeof(AlertLog));
+}
+
+static void *grow(void *buf, int *capacity, size_t size)
+{
+    int next = *capacity ? *capacity * 2 : 64;
+    void *p = realloc(buf, size * next);
+    if (!p) {
+        fprintf(stderr, "Alert log: allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    *capacity = next;
+    return p;
+}
+
+void alert_log_add(AlertLog *log, const Alert *alert)
+{
+    if (log->alert_count == log->alert_capacity) {
+        log->alerts = grow(log->alerts, &log->alert_capacity,
+                           sizeof(AlertRecord));
+    }
+    AlertRecord *rec = &log->alerts[log->alert_count++];
+    memset(rec, 0, sizeof(AlertRecord));
+    rec->worker_rank   = alert->worker_rank;
+    rec->window_id     = alert->window_id;
+    rec->attack_flag   = alert->attack_flag;
+#define X(ID, name) if (alert->name##_detected) rec->detected |= DET_MASK(ID);
+    DETECTOR_LIST(X)
+#undef X
+    rec->total_packets = alert->total_packets;
+    rec->total_flows   = alert->total_flows;
+    rec->true_label    = alert->true_label;
+    ip_to_u32(alert->suspicious_ip, &rec->suspicious_ip);
+    rec->entropy       = alert->entropy;
+    rec->avg_rate      = alert->avg_rate;
+    rec->spike_score   = alert->spike_score;
+    rec->shift_score   = alert->shift_score;
+    rec->processing_time_ms = alert->processing_time_ms;
+    rec->memory_used_kb = alert->memory_used_kb;
+}
+
+void alert_log_verdict(AlertLog *log, int window_id, int global_attack,
+                       const char *chosen_ip)
+{
+    if (log->verdict_count == log->verdict_capacity) {
+        log->verdicts = grow(log->verdicts, &log->verdict_capacity,
+                             sizeof(VerdictRecord));
+    }
+    VerdictRecord *v = &log->verdicts[log->verdict_count++];
+    memset(v, 0, sizeof(VerdictRecord));
+    v->window_id = window_id;
+    v->global_attack = global_attack;
+    if (chosen_ip && chosen_ip[0]) {
+        ip_to_u32(chosen_ip, &v->chosen_ip);
+    }
+}
+
+/*
+   One alerts.csv row.  worker_count is 1 for a single worker's report;
+   under --fanout a row is a subtree aggregate headed by worker_rank,
+   with summed packets, flows, memory and votes and the slowest time.
+*/
+void alert_csv_row(FILE *fp, const Alert *a, int global_attack_flag,
+                   const char *chosen_ip)
+{
+    fprintf(fp,
+            "%d,%d,%d,%s,%.3f,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%d,%.3f,%d,"
+            "%.3f,%ld,%d,%s,%d\n",
+            a->worker_rank,
+            a->window_id,
+            a->attack_flag,
+            a->suspicious_ip,
+            a->entropy,
+            a->avg_rate,
+            a->spike_score,
+            a->total_packets,
+            a->total_flows,
+            a->entropy_detected,
+            a->cusum_detected,
+            a->ml_detected,
+            a->hw_detected,
+            a->shift_detected,
+            a->shift_score,
+            a->rate_detected,
+            a->processing_time_ms,
+            a->memory_used_kb,
+            global_attack_flag,
+            (chosen_ip && chosen_ip[0]) ? chosen_ip : "NONE",
+            a->worker_count);
+}
+
+/* back to an Alert, for converters */
+void alert_log_record(const AlertRecord *rec, Alert *alert)
+{
+    memset(alert, 0, sizeof(Alert));
+    alert->worker_rank   = rec->worker_rank;
+    alert->window_id     = rec->window_id;
+    alert->attack_flag   = rec->attack_flag;
+#define X(ID, name) alert->name##_detected = (rec->detected & DET_MASK(ID)) != 0;
+    DETECTOR_LIST(X)
+#undef X
+    alert->total_packets = rec->total_packets;
+    alert->total_flows   = rec->total_flows;
+    alert->true_label    = rec->true_label;
+    ip_from_u32(rec->suspicious_ip, alert->suspicious_ip);
+    alert->entropy       = rec->entropy;
+    alert->avg_rate      = rec->avg_rate;
+    alert->spike_score   = rec->spike_score;
+    alert->shift_score   = rec->shift_score;
+    alert->processing_time_ms = rec->processing_time_ms;
+    alert->memory_used_kb = (long)rec->memory_used_kb;
+    alert->worker_count  = 1;       /* every rank logs its own alert */
+}
+
+/*
+   Collective over MPI_COMM_WORLD.  Replaces `path` with this run's log
+   and frees the buffers; returns 0, or -1 on every rank if the file
+   could not be written.
+*/
+int alert_log_write(AlertLog *log, const char *path)
+{
+    int rank = 0, size = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    double start = MPI_Wtime();
+
+    /* [0] alerts, [1] verdicts: prefix for offsets, totals for header */
+    long counts[2] = { log->alert_count, log->verdict_count };
+    long before[2] = { 0, 0 }, totals[2] = { 0, 0 };
+    MPI_Exscan(counts, before, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        before[0] = before[1] = 0;  /* undefined on rank 0 */
+    }
+    MPI_Allreduce(counts, totals, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    MPI_Offset alerts_at = (MPI_Offset)sizeof(AlertLogHeader) +
+                           (MPI_Offset)totals[1] * sizeof(VerdictRecord);
+    MPI_Offset offset = alerts_at +
+                        (MPI_Offset)before[0] * sizeof(AlertRecord);
+
+    /* rank 0's alerts start right after the verdicts: one buffer */
+    char *buf = (char *)log->alerts;
+    size_t bytes = sizeof(AlertRecord) * log->alert_count;
+    if (rank == 0) {
+        size_t head = sizeof(AlertLogHeader) +
+                      sizeof(VerdictRecord) * log->verdict_count;
+        buf = malloc(head + bytes + 1);
+        if (!buf) {
+            fprintf(stderr, "Alert log: allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        AlertLogHeader h;
+        memset(&h, 0, sizeof(AlertLogHeader));
+        memcpy(h.magic, ALERT_LOG_MAGIC, sizeof(h.magic));
+        h.alert_size = sizeof(AlertRecord);
+        h.verdict_size = sizeof(VerdictRecord);
+        h.alert_count = totals[0];
+        h.verdict_count = totals[1];
+        h.ranks = size;
+        memcpy(buf, &h, sizeof(AlertLogHeader));
+        memcpy(buf + sizeof(AlertLogHeader), log->verdicts,
+               sizeof(VerdictRecord) * log->verdict_count);
+        if (bytes > 0) {
+            memcpy(buf + head, log->alerts, bytes);
+        }
+        offset = 0;
+        bytes += head;
+    }
+
+    MPI_File fh;
+    int rc = MPI_File_open(MPI_COMM_WORLD, (char *)path,
+                           MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                           &fh);
+    if (rc == MPI_SUCCESS) {
+        MPI_File_set_size(fh, 0);
+        rc = MPI_File_write_at_all(fh, offset, buf, (int)bytes, MPI_BYTE,
+                                   MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+    }
+    int failed = rc != MPI_SUCCESS, any_failed = 0;
+    MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        if (any_failed) {
+            fprintf(stderr, "Alert log: could not write %s\n", path);
+        } else {
+            printf("[COORDINATOR] MPI-IO alert log: %ld alert(s) and %ld "
+                   "verdict(s) from %d rank(s) in %s (%.3f ms)\n",
+                   totals[0], totals[1], size, path,
+                   (MPI_Wtime() - start) * 1000.0);
+        }
+        free(buf);
+    }
+
+    alert_log_free(log);
+    return any_failed ? -1 : 0;
+}
+
+/* drops the records without writing them */
+void alert_log_free(AlertLog *log)
+{
+    free(log->alerts);
+    free(log->verdicts);
+    alert_log_init(log);
+}
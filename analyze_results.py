@@ -67,11 +67,13 @@ def plot_detection_methods(df, output_dir='results/plots'):
     
     fig, ax = plt.subplots(figsize=(10, 6))
     
-    methods = ['entropy_detected', 'cusum_detected', 'ml_detected']
+    methods = ['entropy_detected', 'cusum_detected', 'ml_detected',
+               'hw_detected', 'shift_detected']
     counts = [df[method].sum() for method in methods]
-    labels = ['Entropy', 'CUSUM', 'ML-Based']
+    labels = ['Entropy', 'CUSUM', 'ML-Based', 'Holt-Winters', 'Dist. Shift']
     
-    bars = ax.bar(labels, counts, color=['#FF6B6B', '#4ECDC4', '#45B7D1'])
+    bars = ax.bar(labels, counts, color=['#FF6B6B', '#4ECDC4', '#45B7D1',
+                                         '#F7B801', '#9B5DE5'])
     ax.set_ylabel('Number of Detections')
     ax.set_title('Detection Algorithm Comparison')
     ax.set_xlabel('Detection Method')
@@ -239,7 +241,11 @@ def generate_report(alerts_df, blocking_df, output_file='results/analysis_report
         # System Configuration
         f.write("1. SYSTEM CONFIGURATION\n")
         f.write("-" * 70 + "\n")
-        num_workers = alerts_df['worker_rank'].nunique()
+        # --fanout rows aggregate worker_count workers under their subtree root
+        if 'worker_count' in alerts_df:
+            num_workers = int(alerts_df.groupby('window_id')['worker_count'].sum().max())
+        else:
+            num_workers = alerts_df['worker_rank'].nunique()
         f.write(f"Number of Workers: {num_workers}\n")
         f.write(f"Total Alerts Generated: {len(alerts_df)}\n")
         f.write(f"Total Attacks Detected: {alerts_df['attack_flag'].sum()}\n\n")
@@ -260,7 +266,9 @@ def generate_report(alerts_df, blocking_df, output_file='results/analysis_report
         f.write("-" * 70 + "\n")
         f.write(f"Entropy-based detections: {alerts_df['entropy_detected'].sum()}\n")
         f.write(f"CUSUM detections:         {alerts_df['cusum_detected'].sum()}\n")
-        f.write(f"ML-based detections:      {alerts_df['ml_detected'].sum()}\n\n")
+        f.write(f"ML-based detections:      {alerts_df['ml_detected'].sum()}\n")
+        f.write(f"Holt-Winters detections:  {alerts_df['hw_detected'].sum()}\n")
+        f.write(f"Dist. shift detections:   {alerts_df['shift_detected'].sum()}\n\n")
         
         # Performance Metrics
         f.write("4. PERFORMANCE METRICS\n")
@@ -0,0 +1,238 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* Micro-benchmarks for the detection hot paths (no MPI required) */
+
+#define BENCH_VECTORS  4096
+#define BENCH_ROUNDS    200
+#define BENCH_RECORDS  1000000
+#define BENCH_SOURCES    10000
+#define BENCH_OWNERS         8
+#define BENCH_WINDOW_IPS  5000      /* benign sources in a suspect window */
+
+static void random_vectors(float *vectors, int count)
+{
+    for (int i = 0; i < count; i++) {
+        float *x = vectors + (size_t)i * ML_FEATURES;
+        x[0] = (float)(rand() % 1200) / 100.0f;     /* entropy */
+        x[1] = (float)(rand() % 20000);             /* avg_rate */
+        x[2] = (float)(rand() % 200) / 4.0f;        /* spike_score */
+        x[3] = (float)(rand() % 4096);              /* unique_ips */
+        x[4] = (float)(rand() % 100000);            /* total_packets */
+        x[5] = x[4];                                /* total_flows */
+        x[6] = (float)(rand() % 1500);              /* packet_size_mean */
+        for (int f = 7; f < ML_FEATURES; f++) {
+            x[f] = (float)(rand() % 100) / 100.0f;
+        }
+    }
+}
+
+/* complete binary trees with random splits, written in the model format */
+static int synthetic_forest(int trees, int depth, TreeEnsemble *model)
+{
+    FILE *fp = tmpfile();
+    if (!fp) return -1;
+
+    int nodes = (1 << (depth + 1)) - 1;
+    fprintf(fp, "forest %d %d 0.5\n", trees, ML_FEATURES);
+    for (int t = 0; t < trees; t++) {
+        fprintf(fp, "tree %d\n", nodes);
+        for (int i = 0; i < nodes; i++) {
+            if (2 * i + 2 < nodes) {
+                int f = rand() % ML_FEATURES;
+                fprintf(fp, "node %d %f %d %d\n", f,
+                        (double)(rand() % 1000), 2 * i + 1, 2 * i + 2);
+            } else {
+                fprintf(fp, "leaf %f\n", (double)(rand() % 100) / 100.0);
+            }
+        }
+    }
+    rewind(fp);
+    int rc = forest_load_stream(fp, model);
+    fclose(fp);
+    return rc;
+}
+
+static void bench_forest(const char *name, const TreeEnsemble *model,
+                         const float *vectors, float *scores, int batch)
+{
+    int calls = BENCH_VECTORS / batch;
+    double start = get_time_ms();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int c = 0; c < calls; c++) {
+            forest_predict_batch(model, vectors + (size_t)c * batch * ML_FEATURES,
+                                 batch, scores + c * batch);
+        }
+    }
+    double elapsed = get_time_ms() - start;
+    double per_vector_ns = elapsed * 1e6 /
+                           ((double)BENCH_ROUNDS * calls * batch);
+
+    printf("  %-28s trees=%-3d nodes=%-5d batch=%-5d %8.1f ns/vector\n",
+           name, model->num_trees, model->num_nodes, batch, per_vector_ns);
+}
+
+/* source addresses drawn from a Zipf(s) law over BENCH_SOURCES; s = 0 is uniform */
+static int zipf_sources(uint32_t *ips, int count, double s)
+{
+    double *cdf = malloc(sizeof(double) * BENCH_SOURCES);
+    if (!cdf) return -1;
+
+    double sum = 0.0;
+    for (int k = 0; k < BENCH_SOURCES; k++) {
+        sum += 1.0 / pow(k + 1, s);
+        cdf[k] = sum;
+    }
+    for (int i = 0; i < count; i++) {
+        double u = (double)rand() / ((double)RAND_MAX + 1.0) * sum;
+        int lo = 0, hi = BENCH_SOURCES - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+        }
+        ips[i] = 0x0a000000u + (uint32_t)lo * 2654435761u % 0xffffffu;
+    }
+    free(cdf);
+    return 0;
+}
+
+/*
+   Routes the records over BENCH_OWNERS owners.  Parallel throughput is
+   bounded by the busiest owner, so mean/max load is the share of the
+   ideal throughput the routing leaves.
+*/
+static void bench_routing(const char *name, const uint32_t *ips, int count,
+                          int split)
+{
+    HashRing ring;
+    HotKeys hot;
+    long load[BENCH_OWNERS] = { 0 };
+
+    if (ring_init(&ring, 0, BENCH_OWNERS, RING_VNODES) != 0) return;
+    hotkeys_init(&hot, 0, BENCH_OWNERS);
+
+    double start = get_time_ms();
+    for (int i = 0; i < count; i++) {
+        int point;
+        int owner = split ? hotkeys_route(&hot, &ring, ips[i], &point)
+                          : ring_owner(&ring, ring_key(ips[i]));
+        load[owner]++;
+    }
+    double elapsed = get_time_ms() - start;
+
+    long max = 0;
+    for (int o = 0; o < BENCH_OWNERS; o++) {
+        if (load[o] > max) max = load[o];
+    }
+    double mean = (double)count / BENCH_OWNERS;
+    printf("  %-12s %-14s %6.1f ns/record  max/mean load %5.2f  "
+           "throughput %3.0f%% of ideal\n", name,
+           split ? "ring+hot-keys" : "ring", elapsed * 1e6 / count,
+           max / mean, 100.0 * mean / max);
+    ring_free(&ring);
+}
+
+/*
+   One attack window for select_suspects: BENCH_WINDOW_IPS benign
+   sources with Zipf(s) volumes sharing 40% of the packets and
+   `attackers` sources sharing the other 60%.  Only the attackers should
+   be kept, however heavy the benign end is.
+*/
+static void bench_suspects(const char *name, double s, int attackers)
+{
+    int count = BENCH_WINDOW_IPS + attackers;
+    IpStat *stats = malloc(sizeof(IpStat) * count);
+    Suspect out[MAX_SUSPECTS];
+    if (!stats) return;
+
+    const long benign_packets = 40000, attack_packets = 60000;
+    double sum = 0.0;
+    for (int k = 0; k < BENCH_WINDOW_IPS; k++) {
+        sum += 1.0 / pow(k + 1, s);
+    }
+    for (int k = 0; k < BENCH_WINDOW_IPS; k++) {
+        IpStat *st = &stats[attackers + k];
+        snprintf(st->ip, IP_STR_LEN, "192.168.%d.%d", k / 250, k % 250 + 1);
+        st->packet_count = (int)(benign_packets / pow(k + 1, s) / sum) + 1;
+        st->byte_count = st->packet_count * 800L;
+    }
+    for (int a = 0; a < attackers; a++) {
+        snprintf(stats[a].ip, IP_STR_LEN, "172.16.0.%d", a + 5);
+        stats[a].packet_count = (int)(attack_packets / attackers);
+        stats[a].byte_count = stats[a].packet_count * 1500L;
+    }
+
+    int kept = 0;
+    double start = get_time_ms();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        kept = select_suspects(stats, count, stats[0].ip, out);
+    }
+    double elapsed = get_time_ms() - start;
+
+    int benign = 0;
+    for (int i = 0; i < kept; i++) {
+        if (strncmp(out[i].ip, "172.16.", 7) != 0) benign++;
+    }
+    printf("  %-12s %d attacker(s)  %8.1f us/window  kept %d, %d benign%s\n",
+           name, attackers, elapsed * 1e3 / BENCH_ROUNDS, kept, benign,
+           benign > 0 || kept != attackers ? "  MISMATCH" : "");
+    free(stats);
+}
+
+int main(int argc, char **argv)
+{
+    const char *model_path = (argc > 1) ? argv[1] : "models/ddos_forest.txt";
+
+    float *vectors = malloc(sizeof(float) * BENCH_VECTORS * ML_FEATURES);
+    float *scores  = malloc(sizeof(float) * BENCH_VECTORS);
+    if (!vectors || !scores) {
+        fprintf(stderr, "bench: allocation failed\n");
+        return 1;
+    }
+    srand(42);
+    random_vectors(vectors, BENCH_VECTORS);
+
+    printf("[BENCH] Tree-ensemble inference\n");
+
+    TreeEnsemble model;
+    if (forest_load_model(model_path, &model) == 0) {
+        bench_forest(model_path, &model, vectors, scores, 1);
+        bench_forest(model_path, &model, vectors, scores, BENCH_VECTORS);
+        forest_free(&model);
+    }
+
+    if (synthetic_forest(32, 7, &model) == 0) {
+        bench_forest("synthetic 32x depth 7", &model, vectors, scores, 1);
+        bench_forest("synthetic 32x depth 7", &model, vectors, scores,
+                     BENCH_VECTORS);
+        forest_free(&model);
+    }
+
+    uint32_t *ips = malloc(sizeof(uint32_t) * BENCH_RECORDS);
+    if (ips) {
+        printf("[BENCH] Ingest routing, %d records over %d owners\n",
+               BENCH_RECORDS, BENCH_OWNERS);
+        const double laws[3] = { 0.0, 1.1, 1.5 };
+        const char *names[3] = { "uniform", "zipf 1.1", "zipf 1.5" };
+        for (int l = 0; l < 3; l++) {
+            if (zipf_sources(ips, BENCH_RECORDS, laws[l]) != 0) break;
+            bench_routing(names[l], ips, BENCH_RECORDS, 0);
+            bench_routing(names[l], ips, BENCH_RECORDS, 1);
+        }
+        free(ips);
+    }
+
+    printf("[BENCH] Suspect selection, %d benign sources per window\n",
+           BENCH_WINDOW_IPS);
+    bench_suspects("uniform", 0.0, 1);
+    bench_suspects("zipf 1.1", 1.1, 1);
+    bench_suspects("zipf 1.5", 1.5, 1);
+    bench_suspects("zipf 1.1", 1.1, 4);
+
+    free(scores);
+    free(vectors);
+    return 0;
+}
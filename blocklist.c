@@ -0,0 +1,212 @@
+#include <mpi.h>
+#if defined(OPEN_MPI) && MPI_VERSION < 4
+#include <mpi-ext.h>            /* MPIX_Bcast_init (pcollreq extension) */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Blocklist broadcast & ingest filtering
+   ============================== */
+/*
+   In streaming mode the coordinator's block decisions flow back to the
+   workers.  Newly blocked IPs are queued as a delta and sent with
+   MPI_Ibcast on a duplicate of MPI_COMM_WORLD; up to BLOCK_INFLIGHT
+   broadcasts are outstanding so the coordinator never waits on a busy
+   worker.  Each worker keeps one Ibcast posted, polls it between
+   windows, adds the delta to a BlockSet and drops records from those
+   sources at ingest.  A terminator broadcast (count BLOCK_DELTA_END)
+   closes the channel.
+
+   Every message is 1 + BLOCK_DELTA_MAX uint32: the count, then the IPs.
+   Both sides cycle through the BLOCK_INFLIGHT buffers in the same
+   order, message k in slot k % BLOCK_INFLIGHT.  Where persistent
+   collectives exist (MPI-4 MPI_Bcast_init, or Open MPI's
+   MPIX_Bcast_init before that) each slot is a persistent broadcast set
+   up once and restarted for every delta; otherwise a fresh MPI_Ibcast
+   is issued each time.  Build with -DBLOCK_PERSISTENT=0 or 1 to force
+   either path (make check-build compiles both).
+*/
+
+#define BLOCK_DELTA_END  0xffffffffu
+
+#ifndef BLOCK_PERSISTENT
+#if MPI_VERSION >= 4 || (defined(OMPI_HAVE_MPI_EXT_PCOLLREQ) && \
+                         OMPI_HAVE_MPI_EXT_PCOLLREQ)
+#define BLOCK_PERSISTENT 1
+#else
+#define BLOCK_PERSISTENT 0
+#endif
+#endif
+
+#if BLOCK_PERSISTENT && MPI_VERSION < 4
+#define block_bcast_init MPIX_Bcast_init
+#else
+#define block_bcast_init MPI_Bcast_init
+#endif
+
+static uint32_t blockset_slot(uint32_t ip)
+{
+    return (ip * 2654435761u) >> (32 - BLOCKSET_BITS);
+}
+
+/* open addressing with linear probing; 0 marks an empty slot */
+int blockset_contains(const BlockSet *set, uint32_t ip)
+{
+    if (set->count == 0 || ip == 0) {
+        return 0;
+    }
+    uint32_t i = blockset_slot(ip);
+    while (set->slots[i] != 0) {
+        if (set->slots[i] == ip) {
+            return 1;
+        }
+        i = (i + 1) & (BLOCKSET_SLOTS - 1);
+    }
+    return 0;
+}
+
+int blockset_add(BlockSet *set, uint32_t ip)
+{
+    if (ip == 0 || set->count >= MAX_BLOCKED_IPS) {
+        return 0;
+    }
+    uint32_t i = blockset_slot(ip);
+    while (set->slots[i] != 0) {
+        if (set->slots[i] == ip) {
+            return 0;
+        }
+        i = (i + 1) & (BLOCKSET_SLOTS - 1);
+    }
+    set->slots[i] = ip;
+    set->count++;
+    return 1;
+}
+
+/* starts broadcast number bl->next in its slot; returns the slot */
+static int start_next(Blocklist *bl)
+{
+    int slot = bl->next++ % BLOCK_INFLIGHT;
+#if BLOCK_PERSISTENT
+    MPI_Start(&bl->req[slot]);
+#else
+    MPI_Ibcast(bl->msg[slot], 1 + BLOCK_DELTA_MAX, MPI_UINT32_T, 0, bl->comm,
+               &bl->req[slot]);
+#endif
+    return slot;
+}
+
+/* collective over MPI_COMM_WORLD */
+void blocklist_open(Blocklist *bl, int rank)
+{
+    memset(bl, 0, sizeof(Blocklist));
+    bl->rank = rank;
+    for (int i = 0; i < BLOCK_INFLIGHT; i++) {
+        bl->req[i] = MPI_REQUEST_NULL;
+    }
+    MPI_Comm_dup(MPI_COMM_WORLD, &bl->comm);
+#if BLOCK_PERSISTENT
+    for (int i = 0; i < BLOCK_INFLIGHT; i++) {
+        block_bcast_init(bl->msg[i], 1 + BLOCK_DELTA_MAX, MPI_UINT32_T, 0,
+                         bl->comm, MPI_INFO_NULL, &bl->req[i]);
+    }
+#endif
+    bl->persistent = BLOCK_PERSISTENT;
+    if (rank != 0) {
+        start_next(bl);
+    }
+}
+
+/* coordinator: queue a newly blocked IP for the next broadcast */
+void blocklist_announce(Blocklist *bl, const char *ip)
+{
+    uint32_t addr;
+    if (ip_to_u32(ip, &addr) != 0 || bl->pending_count >= MAX_BLOCKED_IPS) {
+        return;
+    }
+    bl->pending[bl->pending_count++] = addr;
+}
+
+/*
+   Coordinator: broadcasts queued IPs in free slots.  With wait = 0 it
+   returns as soon as every slot is busy; the rest goes out later.
+*/
+void blocklist_flush(Blocklist *bl, int wait)
+{
+    while (bl->pending_count > 0) {
+        int slot = bl->next % BLOCK_INFLIGHT;
+        int done = 0;
+        MPI_Test(&bl->req[slot], &done, MPI_STATUS_IGNORE);
+        if (!done) {
+            if (!wait) return;
+            MPI_Wait(&bl->req[slot], MPI_STATUS_IGNORE);
+        }
+
+        int n = bl->pending_count < BLOCK_DELTA_MAX ?
+                bl->pending_count : BLOCK_DELTA_MAX;
+        bl->msg[slot][0] = (uint32_t)n;
+        memcpy(&bl->msg[slot][1], bl->pending, sizeof(uint32_t) * n);
+        bl->pending_count -= n;
+        memmove(bl->pending, bl->pending + n,
+                sizeof(uint32_t) * bl->pending_count);
+
+        start_next(bl);
+        bl->broadcasts++;
+        bl->announced += n;
+    }
+}
+
+/* worker: applies every delta that has arrived; returns new IPs */
+int blocklist_poll(Blocklist *bl)
+{
+    int added = 0;
+    while (!bl->ended) {
+        int slot = (bl->next - 1) % BLOCK_INFLIGHT;
+        int done = 0;
+        MPI_Test(&bl->req[slot], &done, MPI_STATUS_IGNORE);
+        if (!done) {
+            break;
+        }
+        uint32_t n = bl->msg[slot][0];
+        if (n == BLOCK_DELTA_END) {
+            bl->ended = 1;
+            break;
+        }
+        for (uint32_t i = 0; i < n && i < BLOCK_DELTA_MAX; i++) {
+            added += blockset_add(&bl->set, bl->msg[slot][1 + i]);
+        }
+        bl->broadcasts++;
+        start_next(bl);
+    }
+    return added;
+}
+
+/*
+   Collective over MPI_COMM_WORLD.  The coordinator sends what is left
+   and the terminator; workers apply deltas until the terminator.
+*/
+void blocklist_close(Blocklist *bl)
+{
+    if (bl->rank == 0) {
+        blocklist_flush(bl, 1);
+        MPI_Waitall(BLOCK_INFLIGHT, bl->req, MPI_STATUSES_IGNORE);
+        bl->msg[bl->next % BLOCK_INFLIGHT][0] = BLOCK_DELTA_END;
+        int slot = start_next(bl);
+        MPI_Wait(&bl->req[slot], MPI_STATUS_IGNORE);
+    } else {
+        while (!bl->ended) {
+            MPI_Wait(&bl->req[(bl->next - 1) % BLOCK_INFLIGHT],
+                     MPI_STATUS_IGNORE);
+            /* the request is complete; poll applies it and restarts */
+            blocklist_poll(bl);
+        }
+    }
+#if BLOCK_PERSISTENT
+    for (int i = 0; i < BLOCK_INFLIGHT; i++) {
+        MPI_Request_free(&bl->req[i]);
+    }
+#endif
+    MPI_Comm_free(&bl->comm);
+}
@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L  /* sched_yield */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "detector.h"
+
+/* ==============================
+   Threaded stream coordinator
+   ============================== */
+/*
+   With --threaded the streaming coordinator runs as three threads
+   joined by single-producer single-consumer rings:
+
+   comm      receives every worker message and pushes it to `inbox`;
+             pops newly blocked IPs from `blocks` and broadcasts them
+   decision  (the calling thread) runs the window state machine on
+             `inbox` and votes, as in the single-threaded coordinator
+   action    pops from `actions` and does the file I/O: RTBH/ACL rules,
+             blocking.csv and alerts.csv rows
+
+   A slow disk therefore holds up neither the collection of the next
+   window's alerts nor the broadcast of a block.  The comm thread is the
+   only one calling MPI until coord_threads_stop() joins it, so
+   MPI_THREAD_SERIALIZED is enough; MPI_THREAD_MULTIPLE is requested.
+*/
+
+#define INBOX_SLOTS    256      /* messages from comm to decision */
+#define ACTION_SLOTS  1024      /* pending file actions */
+#define SPIN_YIELDS    256      /* idle polls that yield before sleeping */
+#define CACHE_LINE      64
+
+/* single-producer single-consumer ring */
+typedef struct {
+    char *items;
+    size_t item_size;
+    unsigned mask;
+    unsigned head;              /* next pop; written by the consumer */
+    char pad[CACHE_LINE - sizeof(unsigned)];
+    unsigned tail;              /* next push; written by the producer */
+} SpscQueue;
+
+/* at least `capacity` items, rounded up to a power of two */
+static int spsc_init(SpscQueue *q, unsigned capacity, size_t item_size)
+{
+    unsigned slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    memset(q, 0, sizeof(SpscQueue));
+    q->items = malloc(item_size * slots);
+    q->item_size = item_size;
+    q->mask = slots - 1;
+    return q->items ? 0 : -1;
+}
+
+static void spsc_free(SpscQueue *q)
+{
+    free(q->items);
+    q->items = NULL;
+}
+
+/* producer: 0, or -1 when full */
+static int spsc_push(SpscQueue *q, const void *item)
+{
+    unsigned tail = q->tail;
+    unsigned head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (tail - head > q->mask) {
+        return -1;
+    }
+    memcpy(q->items + (size_t)(tail & q->mask) * q->item_size, item,
+           q->item_size);
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* consumer: 1 if an item was popped */
+static int spsc_pop(SpscQueue *q, void *item)
+{
+    unsigned head = q->head;
+    unsigned tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return 0;
+    }
+    memcpy(item, q->items + (size_t)(head & q->mask) * q->item_size,
+           q->item_size);
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* producer: items not yet popped */
+static unsigned spsc_depth(const SpscQueue *q)
+{
+    return q->tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+}
+
+/* idle polling yields the core first, then sleeps */
+static void idle_wait(int *idle)
+{
+    if (++*idle < SPIN_YIELDS) {
+        sched_yield();
+    } else {
+        sleep_ms(1);
+    }
+}
+
+typedef struct {
+    Alert alert;
+    int source;
+    int tag;
+} InboxItem;
+
+enum { ACTION_BLOCK, ACTION_LOG };
+
+typedef struct {
+    int kind;
+    char ip[IP_STR_LEN];        /* blocked IP, or the window's chosen IP */
+    int global_attack;
+    int count;
+    Alert *alerts;              /* ACTION_LOG: owned copy */
+} Action;
+
+struct CoordThreads {
+    Blocklist *bl;
+    SpscQueue inbox;            /* comm -> decision */
+    SpscQueue blocks;           /* decision -> comm: IPs to broadcast */
+    SpscQueue actions;          /* decision -> action */
+    int stop;                   /* __atomic: no more pushes from decision */
+    pthread_t comm;
+    pthread_t action;
+    long relayed;
+    unsigned max_depth;
+    long actions_done;
+    double action_ms;
+};
+
+static void drain_blocks(CoordThreads *ct)
+{
+    char ip[IP_STR_LEN];
+    int any = 0;
+    while (spsc_pop(&ct->blocks, ip)) {
+        blocklist_announce(ct->bl, ip);
+        any = 1;
+    }
+    if (any || ct->bl->pending_count > 0) {
+        blocklist_flush(ct->bl, 0);
+    }
+}
+
+static void *comm_thread(void *arg)
+{
+    CoordThreads *ct = arg;
+    int idle = 0;
+    int held = 0;               /* a received message waits for space */
+    InboxItem item;
+
+    while (!__atomic_load_n(&ct->stop, __ATOMIC_ACQUIRE)) {
+        drain_blocks(ct);
+
+        if (held) {
+            if (spsc_push(&ct->inbox, &item) != 0) {
+                idle_wait(&idle);
+                continue;
+            }
+            held = 0;
+            ct->relayed++;
+            unsigned depth = spsc_depth(&ct->inbox);
+            if (depth > ct->max_depth) ct->max_depth = depth;
+        }
+
+        int flag = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag,
+                   &status);
+        if (!flag) {
+            idle_wait(&idle);
+            continue;
+        }
+        idle = 0;
+        alert_recv(&item.alert, status.MPI_SOURCE, status.MPI_TAG, &status);
+        item.source = status.MPI_SOURCE;
+        item.tag = status.MPI_TAG;
+        held = 1;
+    }
+    drain_blocks(ct);   /* blocks from the final decisions */
+    return NULL;
+}
+
+static void run_action(CoordThreads *ct, Action *a)
+{
+    double t0 = get_time_ms();
+    if (a->kind == ACTION_BLOCK) {
+        block_suspicious_ip(a->ip);
+    } else {
+        append_alert_log(a->alerts, a->count, a->global_attack, a->ip);
+        free(a->alerts);
+    }
+    ct->action_ms += get_time_ms() - t0;
+    ct->actions_done++;
+}
+
+static void *action_thread(void *arg)
+{
+    CoordThreads *ct = arg;
+    int idle = 0;
+    Action a;
+    for (;;) {
+        if (spsc_pop(&ct->actions, &a)) {
+            run_action(ct, &a);
+            idle = 0;
+            continue;
+        }
+        /* queue drained: write the blocks of the decisions so far */
+        blocking_log_flush();
+        if (__atomic_load_n(&ct->stop, __ATOMIC_ACQUIRE)) {
+            /* stop is set after the last push: one more look */
+            while (spsc_pop(&ct->actions, &a)) {
+                run_action(ct, &a);
+            }
+            blocking_log_flush();
+            break;
+        }
+        idle_wait(&idle);
+    }
+    return NULL;
+}
+
+/* decision thread: blocks until the consumer makes room */
+static void push_wait(SpscQueue *q, const void *item)
+{
+    int idle = 0;
+    while (spsc_push(q, item) != 0) {
+        idle_wait(&idle);
+    }
+}
+
+static void coord_threads_free(CoordThreads *ct)
+{
+    spsc_free(&ct->inbox);
+    spsc_free(&ct->blocks);
+    spsc_free(&ct->actions);
+    free(ct);
+}
+
+/*
+   Starts the comm and action threads and routes `bl`'s blocks through
+   them (bl->async).  Returns NULL if they cannot be started; the caller
+   then coordinates on one thread.
+*/
+CoordThreads *coord_threads_start(Blocklist *bl)
+{
+    CoordThreads *ct = calloc(1, sizeof(CoordThreads));
+    if (!ct) {
+        return NULL;
+    }
+    ct->bl = bl;
+    int ok = spsc_init(&ct->inbox, INBOX_SLOTS, sizeof(InboxItem)) == 0 &&
+             spsc_init(&ct->blocks, MAX_BLOCKED_IPS, IP_STR_LEN) == 0 &&
+             spsc_init(&ct->actions, ACTION_SLOTS, sizeof(Action)) == 0 &&
+             pthread_create(&ct->action, NULL, action_thread, ct) == 0;
+    if (ok && pthread_create(&ct->comm, NULL, comm_thread, ct) != 0) {
+        __atomic_store_n(&ct->stop, 1, __ATOMIC_RELEASE);
+        pthread_join(ct->action, NULL);
+        ok = 0;
+    }
+    if (!ok) {
+        coord_threads_free(ct);
+        return NULL;
+    }
+    bl->async = ct;
+    return ct;
+}
+
+/*
+   Next worker message, as received by the comm thread.  Returns 0 once
+   `deadline` (absolute ms, 0 = none) passes with the inbox empty.
+*/
+int coord_threads_next(CoordThreads *ct, double deadline, Alert *msg,
+                       int *source, int *tag)
+{
+    InboxItem item;
+    int idle = 0;
+    while (!spsc_pop(&ct->inbox, &item)) {
+        if (deadline > 0.0 && get_time_ms() >= deadline) {
+            return 0;
+        }
+        idle_wait(&idle);
+    }
+    *msg = item.alert;
+    *source = item.source;
+    *tag = item.tag;
+    return 1;
+}
+
+/* decision thread: broadcast now, write the rules on the action thread */
+void coord_threads_block(CoordThreads *ct, const char *ip)
+{
+    char copy[IP_STR_LEN];
+    memset(copy, 0, sizeof(copy));
+    strncpy(copy, ip, IP_STR_LEN - 1);
+    push_wait(&ct->blocks, copy);
+
+    Action a;
+    memset(&a, 0, sizeof(Action));
+    a.kind = ACTION_BLOCK;
+    strcpy(a.ip, copy);
+    push_wait(&ct->actions, &a);
+}
+
+/* decision thread: alerts.csv rows for one decided window */
+void coord_threads_log(CoordThreads *ct, const Alert *alerts, int count,
+                       int global_attack, const char *chosen_ip)
+{
+    Action a;
+    memset(&a, 0, sizeof(Action));
+    a.kind = ACTION_LOG;
+    a.count = count;
+    a.global_attack = global_attack;
+    strncpy(a.ip, chosen_ip, IP_STR_LEN - 1);
+    a.alerts = malloc(sizeof(Alert) * (count > 0 ? count : 1));
+    if (!a.alerts) {
+        append_alert_log(alerts, count, global_attack, chosen_ip);
+        return;
+    }
+    memcpy(a.alerts, alerts, sizeof(Alert) * count);
+    push_wait(&ct->actions, &a);
+}
+
+/*
+   After the last decision: lets both threads finish their queues, joins
+   them and frees `ct`.  MPI is back on the calling thread afterwards.
+*/
+void coord_threads_stop(CoordThreads *ct)
+{
+    __atomic_store_n(&ct->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(ct->comm, NULL);
+    pthread_join(ct->action, NULL);
+    ct->bl->async = NULL;
+
+    printf("[COORDINATOR] threaded: %ld message(s) relayed (max inbox "
+           "depth %u), %ld file action(s) off the decision thread "
+           "(%.3f ms)\n", ct->relayed, ct->max_depth, ct->actions_done,
+           ct->action_ms);
+    coord_threads_free(ct);
+}
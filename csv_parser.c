@@ -1,72 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include "detector.h"
 
-#define MAX_LINE 4096
-#define MAX_FIELDS 90
-
 /* Parse CIC-DDoS2019 CSV format and partition data for MPI nodes */
 
-typedef struct {
-    char *fields[MAX_FIELDS];
-    int field_count;
-} CSVRow;
-
-static int parse_csv_line(char *line, CSVRow *row)
-{
-    row->field_count = 0;
-    char *ptr = line;
-    int in_quotes = 0;
-    char *field_start = ptr;
-    
-    while (*ptr && row->field_count < MAX_FIELDS) {
-        if (*ptr == '"') {
-            in_quotes = !in_quotes;
-        } else if (*ptr == ',' && !in_quotes) {
-            *ptr = '\0';
-            row->fields[row->field_count++] = field_start;
-            field_start = ptr + 1;
-        }
-        ptr++;
-    }
-    
-    /* Last field */
-    if (field_start < ptr && row->field_count < MAX_FIELDS) {
-        row->fields[row->field_count++] = field_start;
-    }
-    
-    return row->field_count;
-}
-
-static void trim_whitespace(char *str)
-{
-    char *end;
-    while (isspace((unsigned char)*str)) str++;
-    if (*str == 0) return;
-    
-    end = str + strlen(str) - 1;
-    while (end > str && isspace((unsigned char)*end)) end--;
-    end[1] = '\0';
-}
-
-static int parse_timestamp(const char *ts_str)
-{
-    /* Convert timestamp string to seconds since epoch */
-    /* Format: "2018-12-01 12:36:57.674898" */
-    int year, month, day, hour, min, sec;
-    if (sscanf(ts_str, "%d-%d-%d %d:%d:%d", 
-               &year, &month, &day, &hour, &min, &sec) == 6) {
-        /* Simple conversion (not accurate for all dates but sufficient) */
-        return (year - 1970) * 365 * 24 * 3600 + 
-               month * 30 * 24 * 3600 + 
-               day * 24 * 3600 + 
-               hour * 3600 + min * 60 + sec;
-    }
-    return 0;
-}
-
 int load_cic_ddos_csv(const char *filename, FlowRecord *records, int max_records)
 {
     FILE *fp = fopen(filename, "r");
@@ -75,8 +13,7 @@ int load_cic_ddos_csv(const char *filename, FlowRecord *records, int max_records
         return 0;
     }
     
-    char line[MAX_LINE];
-    CSVRow row;
+    char line[CIC_MAX_LINE];
     int count = 0;
     int header_skipped = 0;
     
@@ -95,60 +32,9 @@ int load_cic_ddos_csv(const char *filename, FlowRecord *records, int max_records
             line[len-1] = '\0';
         }
         
-        if (parse_csv_line(line, &row) < 10) {
-            continue;  /* Not enough fields */
-        }
-        
         FlowRecord r;
-        memset(&r, 0, sizeof(r));
-        
-        /* CIC-DDoS2019 CSV format indices (example):
-         * 0: Flow ID
-         * 1: Source IP
-         * 2: Source Port
-         * 3: Destination IP
-         * 4: Destination Port
-         * 5: Protocol
-         * 6: Timestamp
-         * 7: Flow Duration
-         * 8: Total Fwd Packets
-         * 9: Total Backward Packets
-         * ... many more fields ...
-         * Last field: Label (Benign/Attack type)
-         */
-        
-        /* Extract key fields */
-        if (row.field_count > 1) {
-            strncpy(r.src_ip, row.fields[1], IP_STR_LEN - 1);
-            trim_whitespace(r.src_ip);
-        }
-        
-        if (row.field_count > 3) {
-            strncpy(r.dst_ip, row.fields[3], IP_STR_LEN - 1);
-            trim_whitespace(r.dst_ip);
-        }
-        
-        if (row.field_count > 2) {
-            r.src_port = atoi(row.fields[2]);
-        }
-        
-        if (row.field_count > 4) {
-            r.dst_port = atoi(row.fields[4]);
-        }
-        
-        if (row.field_count > 5) {
-            r.protocol = atoi(row.fields[5]);
-        }
-        
-        if (row.field_count > 6) {
-            r.timestamp = parse_timestamp(row.fields[6]);
-        }
-        
-        /* Estimate bytes from packet counts (if available) */
-        if (row.field_count > 8) {
-            int fwd_pkts = atoi(row.fields[8]);
-            r.packets = fwd_pkts;
-            r.bytes = fwd_pkts * 800;  /* Assume ~800 bytes per packet */
+        if (cic_parse_record(line, &r) != 0) {
+            continue;
         }
         
         records[count++] = r;
@@ -163,8 +49,118 @@ int load_cic_ddos_csv(const char *filename, FlowRecord *records, int max_records
     return count;
 }
 
-/* Partition dataset into N files for MPI workers */
-int partition_dataset(const char *input_file, const char *output_dir, int num_partitions)
+/* Writes records [start, end) as one partition/chunk CSV */
+static int write_records(const char *out_path, const FlowRecord *records,
+                         int start, int end)
+{
+    FILE *fp = fopen(out_path, "w");
+    if (!fp) {
+        fprintf(stderr, "Cannot create %s\n", out_path);
+        return -1;
+    }
+    
+    /* Write CSV header */
+    fprintf(fp, "src_ip,dst_ip,bytes,timestamp,protocol,src_port,dst_port,packets\n");
+    
+    for (int i = start; i < end; i++) {
+        const FlowRecord *r = &records[i];
+        fprintf(fp, "%s,%s,%d,%d,%d,%d,%d,%d\n",
+                r->src_ip, r->dst_ip, r->bytes, r->timestamp,
+                r->protocol, r->src_port, r->dst_port, r->packets);
+    }
+    
+    fclose(fp);
+    return 0;
+}
+
+/*
+   Splits the dataset into chunk_0.csv, chunk_1.csv, ... of chunk_records
+   each, for dynamic scheduling (ddos_detector --chunks).  Chunk files
+   left over from an earlier, larger split are removed.
+*/
+static int write_chunks(const FlowRecord *records, int total,
+                        const char *output_dir, int chunk_records)
+{
+    char out_path[512];
+    int chunks = (total + chunk_records - 1) / chunk_records;
+    
+    for (int c = 0; c < chunks; c++) {
+        int start = c * chunk_records;
+        int end = start + chunk_records;
+        if (end > total) end = total;
+        
+        snprintf(out_path, sizeof(out_path), "%s/chunk_%d.csv", output_dir, c);
+        if (write_records(out_path, records, start, end) != 0) {
+            return -1;
+        }
+    }
+    for (int c = chunks; ; c++) {
+        snprintf(out_path, sizeof(out_path), "%s/chunk_%d.csv", output_dir, c);
+        if (remove(out_path) != 0) break;
+    }
+    
+    printf("  Created %d chunks of up to %d records\n", chunks, chunk_records);
+    return 0;
+}
+
+/*
+   Reorders records so each partition's are contiguous, partition p
+   owning the sources that map to p on a consistent-hash ring.  Fills
+   start[0 .. num_partitions] with the partition boundaries.
+*/
+static int order_by_owner(FlowRecord *records, int total, int num_partitions,
+                          int *start)
+{
+    HashRing ring;
+    int *owner = malloc(sizeof(int) * total);
+    FlowRecord *sorted = malloc(sizeof(FlowRecord) * total);
+    if (!owner || !sorted ||
+        ring_init(&ring, 0, num_partitions, RING_VNODES) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(owner);
+        free(sorted);
+        return -1;
+    }
+
+    memset(start, 0, sizeof(int) * (num_partitions + 1));
+    for (int i = 0; i < total; i++) {
+        uint32_t addr = ring_source(records[i].src_ip);
+        owner[i] = ring_owner(&ring, ring_key(addr));
+        start[owner[i] + 1]++;
+    }
+    for (int p = 0; p < num_partitions; p++) {
+        start[p + 1] += start[p];
+    }
+
+    /* stable counting sort keeps each partition in input order */
+    int *next = malloc(sizeof(int) * num_partitions);
+    if (!next) {
+        fprintf(stderr, "Memory allocation failed\n");
+        ring_free(&ring);
+        free(owner);
+        free(sorted);
+        return -1;
+    }
+    memcpy(next, start, sizeof(int) * num_partitions);
+    for (int i = 0; i < total; i++) {
+        sorted[next[owner[i]]++] = records[i];
+    }
+    memcpy(records, sorted, sizeof(FlowRecord) * total);
+
+    free(next);
+    ring_free(&ring);
+    free(sorted);
+    free(owner);
+    return 0;
+}
+
+/*
+   Partition dataset into N files for MPI workers (plus optional chunks).
+   Records are split by row ranges, or with by_ip by source-IP owner so
+   each source's records stay in one partition.
+*/
+int partition_dataset(const char *input_file, const char *output_dir,
+                      int num_partitions, int chunk_records, int by_ip)
 {
     FlowRecord *all_records = malloc(sizeof(FlowRecord) * MAX_FLOWS * 10);
     if (!all_records) {
@@ -178,60 +174,83 @@ int partition_dataset(const char *input_file, const char *output_dir, int num_pa
         return -1;
     }
     
-    printf("\nPartitioning %d records into %d partitions...\n", total, num_partitions);
+    printf("\nPartitioning %d records into %d partitions%s...\n", total,
+           num_partitions, by_ip ? " by source IP" : "");
+    
+    /* chunks keep the input order */
+    int rc = 0;
+    if (chunk_records > 0) {
+        rc = write_chunks(all_records, total, output_dir, chunk_records);
+    }
     
-    int records_per_partition = (total + num_partitions - 1) / num_partitions;
+    int *bounds = malloc(sizeof(int) * (num_partitions + 1));
+    if (!bounds) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(all_records);
+        return -1;
+    }
+    if (by_ip) {
+        if (order_by_owner(all_records, total, num_partitions, bounds) != 0) {
+            free(bounds);
+            free(all_records);
+            return -1;
+        }
+    } else {
+        int records_per_partition = (total + num_partitions - 1) / num_partitions;
+        for (int p = 0; p <= num_partitions; p++) {
+            bounds[p] = p * records_per_partition;
+            if (bounds[p] > total) bounds[p] = total;
+        }
+    }
     
     for (int p = 0; p < num_partitions; p++) {
         char out_path[512];
         snprintf(out_path, sizeof(out_path), "%s/part_%d.csv", output_dir, p + 1);
         
-        FILE *fp = fopen(out_path, "w");
-        if (!fp) {
-            fprintf(stderr, "Cannot create %s\n", out_path);
-            continue;
-        }
-        
-        /* Write CSV header */
-        fprintf(fp, "src_ip,dst_ip,bytes,timestamp,protocol,src_port,dst_port,packets\n");
-        
-        int start = p * records_per_partition;
-        int end = (p + 1) * records_per_partition;
-        if (end > total) end = total;
+        int start = bounds[p];
+        int end = bounds[p + 1];
         
-        for (int i = start; i < end; i++) {
-            FlowRecord *r = &all_records[i];
-            fprintf(fp, "%s,%s,%d,%d,%d,%d,%d,%d\n",
-                    r->src_ip, r->dst_ip, r->bytes, r->timestamp,
-                    r->protocol, r->src_port, r->dst_port, r->packets);
+        if (write_records(out_path, all_records, start, end) != 0) {
+            continue;
         }
-        
-        fclose(fp);
         printf("  Created %s with %d records\n", out_path, end - start);
     }
     
+    free(bounds);
     free(all_records);
     printf("Partitioning complete.\n");
-    return 0;
+    return rc;
 }
 
 /* Main function for standalone preprocessing */
 int main(int argc, char **argv)
 {
+    int by_ip = argc > 4 && strcmp(argv[argc - 1], "--by-ip") == 0;
+    if (by_ip) {
+        argc--;
+    }
     if (argc < 4) {
-        printf("Usage: %s <input_csv> <output_dir> <num_partitions>\n", argv[0]);
+        printf("Usage: %s <input_csv> <output_dir> <num_partitions> [chunk_records] [--by-ip]\n", argv[0]);
         printf("Example: %s DrDoS_UDP.csv data/partitions 4\n", argv[0]);
+        printf("         %s DrDoS_UDP.csv data/partitions 4 5000   (also write chunks for --chunks)\n", argv[0]);
+        printf("         %s DrDoS_UDP.csv data/partitions 4 --by-ip (each source IP in one partition)\n", argv[0]);
         return 1;
     }
     
     const char *input_file = argv[1];
     const char *output_dir = argv[2];
     int num_partitions = atoi(argv[3]);
+    int chunk_records = argc > 4 ? atoi(argv[4]) : 0;
     
     if (num_partitions < 1 || num_partitions > 100) {
         fprintf(stderr, "Invalid number of partitions: %d\n", num_partitions);
         return 1;
     }
+    if (argc > 4 && chunk_records < 1) {
+        fprintf(stderr, "Invalid chunk size: %s\n", argv[4]);
+        return 1;
+    }
     
-    return partition_dataset(input_file, output_dir, num_partitions);
+    return partition_dataset(input_file, output_dir, num_partitions,
+                             chunk_records, by_ip);
 }
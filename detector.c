@@ -1,17 +1,88 @@
+#define _POSIX_C_SOURCE 200809L  /* nanosleep for follow mode */
+
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
 #include "detector.h"
 
 /* ==============================
    Internal helper prototypes
    ============================== */
+static void worker_detect(int rank, const DetectorConfig *cfg,
+                          const SharedDataset *shared, int mpi_io,
+                          TalkerSummary *talkers, Alert *alert);
+static int  worker_detect_chunks(int rank, const DetectorConfig *cfg,
+                                 MPI_Win chunk_win, TalkerSummary *talkers,
+                                 Alert *alert);
+static int  chunk_worker_init(ChunkWorker *cw, int rank,
+                              const DetectorConfig *cfg, MPI_Win chunk_win,
+                              TalkerSummary *talkers, Alert *alert);
+static int  chunk_worker_step(ChunkWorker *cw);
+static void chunk_worker_finish(ChunkWorker *cw);
+static void fold_chunk_window(ChunkWorker *cw);
+static void merge_alert(Alert *acc, const Alert *in);
+
+/* coordinator's own detection share (--coord-worker) */
+typedef struct {
+    const DetectorConfig *cfg;
+    int partition;              /* part_<n>.csv for the helper thread */
+    int pending;                /* share not tallied yet */
+    int done;                   /* analysis finished; __atomic access */
+    int threaded;
+    pthread_t thread;
+    ChunkWorker chunks;         /* --chunks: claims between receives */
+    TalkerSummary talkers;
+    Alert alert;
+} CoordShare;
+
+/* latest provisional alert of each rank (--provisional) */
+typedef struct {
+    Alert *latest;              /* world_size entries */
+    int *seen;
+    int world_size;
+    int received;
+    long records;               /* flows covered so far, all ranks */
+    int attack;                 /* current provisional verdict */
+    char chosen_ip[IP_STR_LEN];
+    double start_time;
+    double first_ms;            /* time to the first provisional alert */
+} Provisional;
+
+/* coordinator's running one-shot decision */
+typedef struct {
+    char chosen_ip[IP_STR_LEN];
+    char (*blocked)[IP_STR_LEN];        /* every source blocked so far */
+    int blocked_count;
+    int num_ranks;
+    double start_time;
+} Verdict;
+
+static void coord_share_start(CoordShare *own, int world_size,
+                              const DetectorConfig *cfg, MPI_Win chunk_win);
+static int  coordinator_next(CoordShare *own, Provisional *prov,
+                             int num_sources, MPI_Request *requests,
+                             int waiting, double deadline,
+                             MPI_Status *status);
+static void provisional_poll(Provisional *prov);
+static void coordinator_verdict(const AlertTally *tally, const Alert *alerts,
+                                Verdict *v);
+static void finish_notify(int world_size, int together);
+static void verdict_block(const AlertTally *tally, Verdict *v);
+static int  load_raw_slice(int part, const DetectorConfig *cfg, int mpi_io,
+                           FlowRecord *records, int max_records);
 static int  load_partition(int rank, const char *dataset_root,
                            FlowRecord *records, int max_records);
-static void build_ip_stats(FlowRecord *records, int count,
+static int  load_partition_provisional(int rank, const DetectorConfig *cfg,
+                                       FlowRecord *records,
+                                       int max_records);
+static int  find_or_add_ip(IpStat *stats, int *stat_count, const char *ip);
+static void build_ip_stats(const FlowRecord *records, int count,
                            IpStat *stats, int *stat_count,
+                           TrafficHistograms *hist,
                            int *total_packets, long *total_bytes,
                            int *min_ts, int *max_ts);
 static void compute_features(IpStat *stats, int stat_count,
@@ -22,12 +93,19 @@ static void compute_features(IpStat *stats, int stat_count,
 /* detection methods */
 static int detect_entropy_anomaly(const Features *f);
 static int detect_rate_anomaly(const Features *f);
-static int detect_hot_ip(IpStat *stats, int stat_count,
+static int detect_hot_ip(const IpStat *stats, int stat_count,
                          int total_packets, char *out_ip);
 static int detect_cusum_anomaly(const Features *f, CusumState *cusum);
+static int detect_hw_anomaly(const Features *f, HoltWintersState *hw);
+static int detect_shift_anomaly(const TrafficHistograms *hist,
+                                ShiftState *shift);
 static int detect_ml_anomaly(const Features *f, MLDetector *ml);
+static int detect_forest_anomaly(const Features *f,
+                                 const TreeEnsemble *forest);
 static void init_cusum_state(CusumState *cusum);
 static void init_ml_detector(MLDetector *ml);
+static void init_hw_state(HoltWintersState *hw, int season_len);
+static void init_shift_state(ShiftState *shift);
 
 /* blocking simulation */
 static void apply_rtbh(const char *ip, BlockingStats *stats);
@@ -38,56 +116,469 @@ double get_time_ms(void);
 void init_performance_metrics(PerformanceMetrics *metrics);
 void calculate_accuracy_metrics(PerformanceMetrics *metrics);
 void log_performance_metrics(const PerformanceMetrics *metrics, const char *filename);
-void log_blocking_stats(const BlockingStats *stats, const char *filename);
+void log_blocking_stats(const BlockingStats *stats, int count,
+                        const char *filename);
 
 /* metrics logging */
-static void append_alert_log(const Alert *alerts, int num_alerts,
-                             int global_attack_flag,
-                             const char *chosen_ip);
+void append_alert_log(const Alert *alerts, int num_alerts,
+                      int global_attack_flag, const char *chosen_ip);
 
 /* ==============================
    Worker side
    ============================== */
-void worker_start(int rank, int world_size, const char *dataset_root)
+void worker_start(int rank, int world_size, const DetectorConfig *cfg)
 {
-    double start_time = get_time_ms();
-    
-    FlowRecord *records = malloc(sizeof(FlowRecord) * MAX_FLOWS);
-    if (!records) {
-        fprintf(stderr, "Worker %d: memory allocation failed\n", rank);
+    if (cfg->stream) {
+        worker_stream(rank, world_size, cfg);
+        return;
+    }
+
+    MPI_Win chunk_win = MPI_WIN_NULL;
+    if (cfg->chunks) {
+        chunk_counter_create(rank, &chunk_win);
+    }
+    SharedDataset shared;
+    if (cfg->shared) {
+        shared_dataset_load(rank, cfg, &shared);
+    }
+
+    /* aggregation tree: pre-post the children's receives before working */
+    int first_child = 0, num_children = 0;
+    Alert *child_alerts = NULL;
+    MPI_Request *requests = NULL;
+    char *wire = NULL;
+    int wire_bytes = wire_max_bytes();
+
+    if (cfg->fanout > 0) {
+        tree_children(rank, cfg->fanout, world_size,
+                      &first_child, &num_children);
+    }
+    if (num_children > 0) {
+        child_alerts = malloc(sizeof(Alert) * num_children);
+        requests = malloc(sizeof(MPI_Request) * num_children);
+        wire = malloc((size_t)wire_bytes * num_children);
+        if (!child_alerts || !requests || !wire) {
+            fprintf(stderr, "Worker %d: tree allocation failed\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (int c = 0; c < num_children; c++) {
+            MPI_Irecv(wire + (size_t)c * wire_bytes, wire_bytes, MPI_PACKED,
+                      first_child + c, TAG_ALERT, MPI_COMM_WORLD,
+                      &requests[c]);
+        }
+    }
+
+    TalkerSummary talkers;
+    Alert alert;
+    int chunks = 0;
+    talkers_init(&talkers);
+    if (cfg->chunks) {
+        chunks = worker_detect_chunks(rank, cfg, chunk_win, &talkers, &alert);
+    } else {
+        worker_detect(rank, cfg, cfg->shared ? &shared : NULL, 1,
+                      &talkers, &alert);
+    }
+    if (cfg->shared) {
+        shared_dataset_free(&shared);
+    }
+    AlertLog log;
+    alert_log_init(&log);
+    if (cfg->mpiio_log) {
+        alert_log_add(&log, &alert);    /* own alert, before any merge */
+    }
+
+    /* fold in each child subtree as it arrives, then forward one alert */
+    for (int i = 0; i < num_children; i++) {
+        int c;
+        MPI_Status status;
+        MPI_Waitany(num_children, requests, &c, &status);
+        int bytes = 0;
+        MPI_Get_count(&status, MPI_PACKED, &bytes);
+        alert_unpack(wire + (size_t)c * wire_bytes, bytes, &child_alerts[c]);
+        merge_alert(&alert, &child_alerts[c]);
+    }
+
+    int parent = cfg->fanout > 0 ? tree_parent(rank, cfg->fanout) : 0;
+    alert_send(&alert, parent, TAG_ALERT);
+
+    free(wire);
+    free(requests);
+    free(child_alerts);
+
+    /* with a deadline, rank 0 says whether the collectives below run */
+    int together = 1;
+    if (cfg->deadline_ms > 0) {
+        MPI_Recv(&together, 1, MPI_INT, 0, TAG_FINISH, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    }
+    if (!together) {
+        alert_log_free(&log);
         return;
     }
 
-    int flow_count = load_partition(rank, dataset_root, records, MAX_FLOWS);
+    /* collective: every worker contributes, with or without data */
+    talkers_reduce(&talkers, NULL);
+
+    if (cfg->chunks) {
+        chunk_counter_free(rank, &chunk_win, chunks, NULL);
+    }
+    if (cfg->mpiio_log) {
+        alert_log_write(&log, ALERT_LOG_PATH);
+    }
+}
+
+/*
+   One-shot analysis of the whole partition into `alert` (a "no data"
+   alert if nothing could be analyzed); adds its sources to talkers.
+   With a shared dataset the records are this rank's slice of the node
+   region and are not loaded or copied here.
+*/
+static void worker_detect(int rank, const DetectorConfig *cfg,
+                          const SharedDataset *shared, int mpi_io,
+                          TalkerSummary *talkers, Alert *alert)
+{
+    double start_time = get_time_ms();
+    const char *dataset_root = cfg->dataset_root;
+
+    memset(alert, 0, sizeof(Alert));
+    alert->worker_rank = rank;
+    alert->worker_count = 1;
+    
+    FlowRecord *owned = NULL;
+    const FlowRecord *records;
+    int flow_count;
+
+    if (shared) {
+        records = shared->records;
+        flow_count = shared->count;
+    } else {
+        owned = malloc(sizeof(FlowRecord) * MAX_FLOWS);
+        if (!owned) {
+            fprintf(stderr, "Worker %d: memory allocation failed\n", rank);
+            return;
+        }
+        /* provisional alerts go from worker ranks to rank 0 only */
+        int me = 0;
+        if (cfg->provisional > 0 && mpi_io) {
+            MPI_Comm_rank(MPI_COMM_WORLD, &me);
+        }
+        if (cfg->raw_input) {
+            flow_count = load_raw_slice(rank, cfg, mpi_io, owned, MAX_FLOWS);
+        } else if (me != 0) {
+            flow_count = load_partition_provisional(rank, cfg, owned,
+                                                    MAX_FLOWS);
+        } else {
+            flow_count = load_partition(rank, dataset_root, owned, MAX_FLOWS);
+        }
+        records = owned;
+    }
     if (flow_count <= 0) {
-        /* Send a "no data" alert */
-        Alert alert;
-        memset(&alert, 0, sizeof(Alert));
-        alert.worker_rank = rank;
-        MPI_Send(&alert, sizeof(Alert), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
-        free(records);
+        free(owned);
         return;
     }
 
     IpStat *stats = malloc(sizeof(IpStat) * MAX_UNIQUE_IPS);
     if (!stats) {
         fprintf(stderr, "Worker %d: stats allocation failed\n", rank);
-        free(records);
+        free(owned);
         return;
     }
     
     /* Initialize detection algorithms */
-    CusumState cusum;
-    MLDetector ml;
-    init_cusum_state(&cusum);
-    init_ml_detector(&ml);
+    DetectorContext detectors;
+    detector_context_init(&detectors, cfg);
+
+    CascadeStats cascade;
+    memset(&cascade, 0, sizeof(CascadeStats));
+
+    int stat_count = analyze_window(&detectors, records, flow_count, stats,
+                                    rank, 0, &cascade, alert);
+    
+    /* Performance metrics */
+    double end_time = get_time_ms();
+    alert->processing_time_ms = end_time - start_time;
+
+    talkers_add_stats(talkers, stats, stat_count);
+
+    if (cfg->cascade) {
+        print_cascade_stats(rank, &cascade);
+    }
+
+    detector_context_free(&detectors);
+    free(stats);
+    free(owned);
+}
+
+/*
+   Dynamic-scheduling variant of worker_detect: claims chunk files until
+   none is left.  Records are analyzed in windows of up to MAX_FLOWS and
+   the window alerts folded into one alert for this worker.  Returns the
+   number of chunks analyzed.
+*/
+static int worker_detect_chunks(int rank, const DetectorConfig *cfg,
+                                 MPI_Win chunk_win, TalkerSummary *talkers,
+                                 Alert *alert)
+{
+    ChunkWorker cw;
+    if (chunk_worker_init(&cw, rank, cfg, chunk_win, talkers, alert) != 0) {
+        /* claims nothing; the other workers take every chunk */
+        return 0;
+    }
+    while (chunk_worker_step(&cw)) {
+    }
+    chunk_worker_finish(&cw);
+    return cw.chunks;
+}
+
+/* starts `alert` as this rank's empty report; -1 if out of memory */
+static int chunk_worker_init(ChunkWorker *cw, int rank,
+                             const DetectorConfig *cfg, MPI_Win chunk_win,
+                             TalkerSummary *talkers, Alert *alert)
+{
+    memset(cw, 0, sizeof(ChunkWorker));
+    cw->rank = rank;
+    cw->cfg = cfg;
+    cw->win = chunk_win;
+    cw->talkers = talkers;
+    cw->alert = alert;
+    cw->start_time = get_time_ms();
+
+    memset(alert, 0, sizeof(Alert));
+    alert->worker_rank = rank;
+    alert->worker_count = 1;
+
+    cw->records = malloc(sizeof(FlowRecord) * MAX_FLOWS);
+    cw->stats = malloc(sizeof(IpStat) * MAX_UNIQUE_IPS);
+    if (!cw->records || !cw->stats) {
+        fprintf(stderr, "Worker %d: memory allocation failed\n", rank);
+        free(cw->records);
+        free(cw->stats);
+        return -1;
+    }
+    detector_context_init(&cw->detectors, cfg);
+    return 0;
+}
+
+/* claims and analyzes one chunk; returns 0 once none is left */
+static int chunk_worker_step(ChunkWorker *cw)
+{
+    char path[512];
+    FlowSource src;
+    int index = chunk_claim(cw->win);
+
+    snprintf(path, sizeof(path), "%s/partitions/chunk_%d.csv",
+             cw->cfg->dataset_root, index);
+    if (flow_source_open_path(&src, cw->rank, path, 0) != 0) {
+        return 0;               /* past the last chunk */
+    }
+    cw->chunks++;
+
+    for (;;) {
+        int n = flow_source_read(&src, cw->records + cw->count,
+                                 MAX_FLOWS - cw->count);
+        if (n <= 0) break;
+        cw->count += n;
+        if (cw->count == MAX_FLOWS) {
+            fold_chunk_window(cw);
+        }
+    }
+    cw->total += src.records_read;
+    flow_source_close(&src);
+    return 1;
+}
+
+/* analyzes the partial last window and completes the alert */
+static void chunk_worker_finish(ChunkWorker *cw)
+{
+    if (cw->count > 0) {
+        fold_chunk_window(cw);
+    }
+
+    if (cw->chunks == 0) {
+        fprintf(stderr, "Worker %d: no chunk files to claim under "
+                        "%s/partitions\n", cw->rank, cw->cfg->dataset_root);
+    } else {
+        printf("Worker %d: processed %d chunk(s), %ld records\n",
+               cw->rank, cw->chunks, cw->total);
+    }
+    cw->alert->processing_time_ms = get_time_ms() - cw->start_time;
 
+    if (cw->cfg->cascade) {
+        print_cascade_stats(cw->rank, &cw->cascade);
+    }
+
+    detector_context_free(&cw->detectors);
+    free(cw->stats);
+    free(cw->records);
+}
+
+/* analyzes the buffered window and folds it into the worker's alert */
+static void fold_chunk_window(ChunkWorker *cw)
+{
+    Alert part;
+    Alert *alert = cw->alert;
+    int stat_count = analyze_window(&cw->detectors, cw->records, cw->count,
+                                    cw->stats, cw->rank, 0, &cw->cascade,
+                                    &part);
+    talkers_add_stats(cw->talkers, cw->stats, stat_count);
+    cw->count = 0;
+
+    if (cw->windows++ == 0) {
+        *alert = part;
+        return;
+    }
+    merge_alert(alert, &part);
+    /* still one worker, voting attack if any of its windows did */
+    alert->attack_votes = alert->attack_votes > 0;
+    alert->attack_flag  = alert->attack_votes;
+    alert->worker_count = 1;
+    for (int i = 0; i < alert->suspect_count; i++) {
+        alert->suspects[i].reports = 1;
+    }
+}
+
+/* ==============================
+   Dynamic chunk scheduling
+   ============================== */
+/*
+   With --chunks, rank 0 exposes one int in an RMA window.  Workers claim
+   chunk indices with an atomic MPI_Fetch_and_op and stop at the first
+   index that has no chunk file, so fast workers simply take more chunks
+   and the run ends near the average worker load.  Create and free are
+   collective over MPI_COMM_WORLD.
+*/
+void chunk_counter_create(int rank, MPI_Win *win)
+{
+    int *base = NULL;
+    MPI_Aint size = rank == 0 ? (MPI_Aint)sizeof(int) : 0;
+
+    MPI_Win_allocate(size, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD,
+                     &base, win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, *win);
+        *base = 0;
+        MPI_Win_unlock(0, *win);
+    }
+    /* no claim before the counter is zeroed */
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+int chunk_claim(MPI_Win win)
+{
+    int one = 1, index = 0;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+    MPI_Fetch_and_op(&one, &index, MPI_INT, 0, 0, MPI_SUM, win);
+    MPI_Win_unlock(0, win);
+    return index;
+}
+
+/*
+   Frees the counter.  `analyzed` is the number of chunks this rank
+   processed; rank 0 gets the total back and, in `workers`, how many
+   ranks processed at least one.  The counter itself overshoots by one
+   failed claim per claiming rank, and a rank that could not allocate
+   never claims, so it is not used for the count.
+*/
+int chunk_counter_free(int rank, MPI_Win *win, int analyzed, int *workers)
+{
+    int mine[2] = { analyzed, analyzed > 0 };
+    int total[2] = { 0, 0 };
+    MPI_Reduce(mine, total, 2, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Win_free(win);
+    if (rank == 0 && workers) {
+        *workers = total[1];
+    }
+    return total[0];
+}
+
+/* ==============================
+   Aggregation tree
+   ============================== */
+/*
+   With --fanout k, ranks form a k-ary tree rooted at the coordinator:
+   rank r reports to (r - 1) / k and hears from ranks k*r + 1 .. k*r + k.
+   Every interior worker merges its subtree into one alert, so no rank
+   receives more than k messages.
+*/
+int tree_parent(int rank, int fanout)
+{
+    return (rank - 1) / fanout;
+}
+
+void tree_children(int rank, int fanout, int world_size,
+                   int *first, int *count)
+{
+    long lo = (long)rank * fanout + 1;
+    long hi = lo + fanout;
+    if (hi > world_size) hi = world_size;
+    *first = (int)lo;
+    *count = lo < hi ? (int)(hi - lo) : 0;
+}
+
+/*
+   Folds a subtree alert into `acc`.  Volumes, votes and the suspect
+   lists add up; the representative fields (suspicious IP, rate,
+   detector flags) come from the attack alert with the highest avg_rate, or the highest
+   avg_rate overall when neither side voted attack.  This matches the
+   coordinator's flat tally, so the verdict is the same either way.
+*/
+static void merge_alert(Alert *acc, const Alert *in)
+{
+    int take = (in->attack_votes > 0 && acc->attack_votes == 0) ||
+               ((in->attack_votes > 0) == (acc->attack_votes > 0) &&
+                in->avg_rate > acc->avg_rate);
+
+    long   total_packets = (long)acc->total_packets + in->total_packets;
+    long   total_flows   = (long)acc->total_flows + in->total_flows;
+    long   memory_kb     = acc->memory_used_kb + in->memory_used_kb;
+    int    votes         = acc->attack_votes + in->attack_votes;
+    int    workers       = acc->worker_count + in->worker_count;
+    int    label         = acc->true_label || in->true_label;
+    double time_ms       = acc->processing_time_ms > in->processing_time_ms ?
+                           acc->processing_time_ms : in->processing_time_ms;
+    int    rank          = acc->worker_rank;
+    int    window_id     = acc->window_id;
+    Suspect suspects[MAX_SUSPECTS];
+    int    suspect_count = acc->suspect_count;
+
+    memcpy(suspects, acc->suspects, sizeof(Suspect) * suspect_count);
+    suspects_merge(suspects, &suspect_count, in->suspects, in->suspect_count);
+
+    if (take) {
+        *acc = *in;
+    }
+    memcpy(acc->suspects, suspects, sizeof(Suspect) * suspect_count);
+    acc->suspect_count    = suspect_count;
+    acc->worker_rank      = rank;
+    acc->window_id        = window_id;
+    acc->total_packets    = (int)total_packets;
+    acc->total_flows      = (int)total_flows;
+    acc->memory_used_kb   = memory_kb;
+    acc->attack_votes     = votes;
+    acc->worker_count     = workers;
+    acc->attack_flag      = votes > 0;
+    acc->true_label       = label;
+    acc->processing_time_ms = time_ms;
+}
+
+/*
+   Runs the full per-window analysis (IP stats, features, detectors,
+   vote) over `count` records and fills `alert`.  `stats` is scratch
+   space for MAX_UNIQUE_IPS entries and holds the window's per-IP stats
+   on return; the number of entries is returned.  processing_time_ms is
+   left to the caller, which knows what to include in it.
+*/
+int analyze_window(DetectorContext *detectors, const FlowRecord *records,
+                    int count, IpStat *stats, int rank, int window_id,
+                    CascadeStats *cascade, Alert *alert)
+{
     int stat_count = 0;
     int total_packets = 0;
     long total_bytes = 0;
     int min_ts = 0, max_ts = 0;
+    TrafficHistograms hist;
 
-    build_ip_stats(records, flow_count, stats, &stat_count,
+    build_ip_stats(records, count, stats, &stat_count, &hist,
                    &total_packets, &total_bytes, &min_ts, &max_ts);
 
     Features feats;
@@ -95,64 +586,164 @@ void worker_start(int rank, int world_size, const char *dataset_root)
     compute_features(stats, stat_count, total_packets, total_bytes,
                      min_ts, max_ts, &feats);
 
-    /* Run all three detection algorithms */
-    int flag_entropy = detect_entropy_anomaly(&feats);
-    int flag_cusum   = detect_cusum_anomaly(&feats, &cusum);
-    int flag_ml      = detect_ml_anomaly(&feats, &ml);
+    WindowInput in;
+    in.feats = &feats;
+    in.hist = &hist;
+    in.stats = stats;
+    in.stat_count = stat_count;
+    in.total_packets = total_packets;
 
+    /* Run the enabled detectors (cascade mode stops voting once decided) */
+    int flags[DET_COUNT];
     char hot_ip[IP_STR_LEN];
-    hot_ip[0] = '\0';
-    int flag_hot_ip  = detect_hot_ip(stats, stat_count,
-                                     total_packets, hot_ip);
-
-    Alert alert;
-    memset(&alert, 0, sizeof(Alert));
-    alert.worker_rank = rank;
-    alert.entropy     = feats.entropy;
-    alert.avg_rate    = feats.avg_rate;
-    alert.spike_score = feats.spike_score;
-    alert.total_packets = feats.total_packets;
-    alert.total_flows   = feats.total_flows;
+    int votes = run_detectors(detectors, &in, flags, hot_ip, cascade);
+
+    memset(alert, 0, sizeof(Alert));
+    alert->worker_rank = rank;
+    alert->window_id   = window_id;
+    alert->worker_count = 1;
+    alert->entropy     = feats.entropy;
+    alert->avg_rate    = feats.avg_rate;
+    alert->spike_score = feats.spike_score;
+    alert->total_packets = feats.total_packets;
+    alert->total_flows   = feats.total_flows;
     
     /* Detection flags */
-    alert.entropy_detected = flag_entropy;
-    alert.cusum_detected   = flag_cusum;
-    alert.ml_detected      = flag_ml;
-
-    /* Voting: attack if at least 2 out of 3 algorithms detect anomaly */
-    if (flag_entropy + flag_cusum + flag_ml >= 2) {
-        alert.attack_flag = 1;
+#define X(ID, name) alert->name##_detected = flags[DET_##ID##_BIT];
+    DETECTOR_LIST(X)
+#undef X
+    alert->shift_score = detectors->shift.last_score;
+
+    /* Voting: attack if at least VOTE_THRESHOLD detectors flag anomaly */
+    if (votes >= VOTE_THRESHOLD) {
+        alert->attack_flag = 1;
+        alert->attack_votes = 1;
         if (hot_ip[0] != '\0') {
-            strncpy(alert.suspicious_ip, hot_ip, IP_STR_LEN - 1);
-            alert.suspicious_ip[IP_STR_LEN - 1] = '\0';
+            strncpy(alert->suspicious_ip, hot_ip, IP_STR_LEN - 1);
+            alert->suspicious_ip[IP_STR_LEN - 1] = '\0';
         } else {
-            strncpy(alert.suspicious_ip, feats.top_ip, IP_STR_LEN - 1);
-            alert.suspicious_ip[IP_STR_LEN - 1] = '\0';
+            strncpy(alert->suspicious_ip, feats.top_ip, IP_STR_LEN - 1);
+            alert->suspicious_ip[IP_STR_LEN - 1] = '\0';
         }
+        alert->suspect_count = select_suspects(stats, stat_count,
+                                               alert->suspicious_ip,
+                                               alert->suspects);
     } else {
-        alert.attack_flag = 0;
-        strncpy(alert.suspicious_ip, "NONE", IP_STR_LEN - 1);
-        alert.suspicious_ip[IP_STR_LEN - 1] = '\0';
+        alert->attack_flag = 0;
+        strncpy(alert->suspicious_ip, "NONE", IP_STR_LEN - 1);
+        alert->suspicious_ip[IP_STR_LEN - 1] = '\0';
     }
-    
-    /* Performance metrics */
-    double end_time = get_time_ms();
-    alert.processing_time_ms = end_time - start_time;
-    alert.memory_used_kb = (sizeof(FlowRecord) * flow_count + 
-                           sizeof(IpStat) * stat_count) / 1024;
 
-    MPI_Send(&alert, sizeof(Alert), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+    alert->memory_used_kb = (sizeof(FlowRecord) * count +
+                            sizeof(IpStat) * stat_count) / 1024;
+    return stat_count;
+}
 
-    free(stats);
-    free(records);
+static int by_suspect_volume(const void *a, const void *b)
+{
+    const Suspect *x = a;
+    const Suspect *y = b;
+    if (x->packets != y->packets) {
+        return x->packets < y->packets ? 1 : -1;
+    }
+    if (x->bytes != y->bytes) {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return strcmp(x->ip, y->ip);
+}
+
+/*
+   Top-K suspects of an attack window: the primary suspect first, then
+   the heaviest other sources that are anomalous on their own, holding
+   at least SUSPECT_SHARE of the window's packets and SUSPECT_RATIO of
+   the primary's.  A relative floor such as a multiple of the mean also
+   catches the ordinary heavy end of benign traffic.  Selection keeps a
+   sorted array of K, so it is one pass over the window's sources.
+*/
+int select_suspects(const IpStat *stats, int stat_count,
+                    const char *primary, Suspect *out)
+{
+    long total = 0;
+    int n = 0;
+    for (int i = 0; i < stat_count; i++) {
+        total += stats[i].packet_count;
+        if (n == 0 && strcmp(stats[i].ip, primary) == 0) {
+            strcpy(out[0].ip, stats[i].ip);
+            out[0].packets = stats[i].packet_count;
+            out[0].bytes   = stats[i].byte_count;
+            out[0].reports = 1;
+            n = 1;
+        }
+    }
+    double floor = SUSPECT_SHARE * (double)total;
+    if (n == 1 && SUSPECT_RATIO * (double)out[0].packets > floor) {
+        floor = SUSPECT_RATIO * (double)out[0].packets;
+    }
+
+    /* the primary keeps its place; the rest compete for K - 1 */
+    int first = n;
+    for (int i = 0; i < stat_count; i++) {
+        long packets = stats[i].packet_count;
+        if (packets <= 0 || packets < floor ||
+            (first && strcmp(stats[i].ip, primary) == 0)) {
+            continue;
+        }
+        if (n == MAX_SUSPECTS && packets <= out[n - 1].packets) {
+            continue;
+        }
+        int pos = n < MAX_SUSPECTS ? n++ : n - 1;
+        while (pos > first && out[pos - 1].packets < packets) {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        strcpy(out[pos].ip, stats[i].ip);
+        out[pos].packets = packets;
+        out[pos].bytes   = stats[i].byte_count;
+        out[pos].reports = 1;
+    }
+    return n;
+}
+
+/*
+   Folds `in` into the suspect list `acc`: volumes and report counts of
+   the same source add up and the MAX_SUSPECTS heaviest are kept.
+*/
+void suspects_merge(Suspect *acc, int *count, const Suspect *in, int in_count)
+{
+    Suspect all[2 * MAX_SUSPECTS];
+    int n = *count;
+    memcpy(all, acc, sizeof(Suspect) * n);
+
+    for (int j = 0; j < in_count; j++) {
+        int found = 0;
+        for (int i = 0; i < *count; i++) {
+            if (strcmp(all[i].ip, in[j].ip) == 0) {
+                all[i].packets += in[j].packets;
+                all[i].bytes   += in[j].bytes;
+                all[i].reports += in[j].reports;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            all[n++] = in[j];
+        }
+    }
+
+    qsort(all, n, sizeof(Suspect), by_suspect_volume);
+    *count = n < MAX_SUSPECTS ? n : MAX_SUSPECTS;
+    memcpy(acc, all, sizeof(Suspect) * (*count));
 }
 
 /* ==============================
    Coordinator side
    ============================== */
-void coordinator_start(int world_size, const char *dataset_root)
+void coordinator_start(int world_size, const DetectorConfig *cfg)
 {
-    (void)dataset_root; /* currently unused, keep signature flexible */
+    if (cfg->stream) {
+        coordinator_stream(world_size, cfg);
+        return;
+    }
 
     int num_workers = world_size - 1;
     if (num_workers <= 0) {
@@ -160,71 +751,687 @@ void coordinator_start(int world_size, const char *dataset_root)
         return;
     }
 
-    Alert *alerts = malloc(sizeof(Alert) * num_workers);
-    if (!alerts) {
+    MPI_Win chunk_win = MPI_WIN_NULL;
+    if (cfg->chunks) {
+        chunk_counter_create(0, &chunk_win);
+    }
+    if (cfg->shared) {
+        /* collective split; the coordinator holds no node data */
+        SharedDataset none;
+        shared_dataset_load(0, cfg, &none);
+    }
+
+    /* every worker reports directly, or only the tree's top level does */
+    int num_sources = num_workers;
+    if (cfg->fanout > 0) {
+        int first_child = 0;
+        tree_children(0, cfg->fanout, world_size, &first_child, &num_sources);
+        printf("[COORDINATOR] aggregation tree: fanout %d, %d direct "
+               "report(s) for %d worker(s)\n",
+               cfg->fanout, num_sources, num_workers);
+    }
+
+    /* with --coord-worker rank 0's own share is one more report */
+    int num_ranks = num_workers + (cfg->coord_worker ? 1 : 0);
+    int num_reports = num_sources + (cfg->coord_worker ? 1 : 0);
+
+    int wire_bytes = wire_max_bytes();
+    Alert *alerts = malloc(sizeof(Alert) * num_reports);
+    int *counted = calloc(num_reports, sizeof(int));
+    MPI_Request *requests = malloc(sizeof(MPI_Request) * num_sources);
+    char *wire = malloc((size_t)wire_bytes * num_sources);
+    if (!alerts || !counted || !requests || !wire) {
         fprintf(stderr, "Coordinator: alert allocation failed\n");
+        free(alerts);
+        free(counted);
+        free(requests);
+        free(wire);
         return;
     }
 
-    int i;
-    int attack_votes = 0;
-    int chosen_index = -1;
+    /* Pre-post one receive per source; handle alerts as they complete */
+    for (int w = 0; w < num_sources; w++) {
+        MPI_Irecv(wire + (size_t)w * wire_bytes, wire_bytes, MPI_PACKED,
+                  w + 1, TAG_ALERT, MPI_COMM_WORLD, &requests[w]);
+    }
+
+    CoordShare own;
+    coord_share_start(&own, world_size, cfg, chunk_win);
+
+    AlertTally tally;
+    tally_init(&tally);
+    double start_time = get_time_ms();
+    double deadline = cfg->deadline_ms > 0 ?
+                      start_time + cfg->deadline_ms : 0.0;
+    Verdict verdict;
+    memset(&verdict, 0, sizeof(Verdict));
+    verdict.blocked = malloc(IP_STR_LEN * MAX_BLOCKED_IPS);
+    verdict.num_ranks = num_ranks;
+    verdict.start_time = start_time;
+    if (!verdict.blocked) {
+        fprintf(stderr, "Coordinator: blocklist allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    Provisional prov;
+    Provisional *pv = NULL;
+    if (cfg->provisional > 0) {
+        memset(&prov, 0, sizeof(Provisional));
+        prov.latest = malloc(sizeof(Alert) * world_size);
+        prov.seen = calloc(world_size, sizeof(int));
+        prov.world_size = world_size;
+        prov.start_time = start_time;
+        if (!prov.latest || !prov.seen) {
+            fprintf(stderr, "Coordinator: provisional allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        pv = &prov;
+    }
 
-    for (i = 0; i < num_workers; i++) {
+    int waiting = num_sources;
+    int tallied = 0;
+    while (tallied < num_reports) {
         MPI_Status status;
-        MPI_Recv(&alerts[i], sizeof(Alert), MPI_BYTE,
-                 MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &status);
+        int w = coordinator_next(&own, pv, num_sources, requests, waiting,
+                                 deadline, &status);
+        if (w < 0) {
+            break;              /* deadline: decide with what we have */
+        }
+        if (w == num_sources) {
+            alerts[w] = own.alert;
+        } else {
+            int bytes = 0;
+            MPI_Get_count(&status, MPI_PACKED, &bytes);
+            alert_unpack(wire + (size_t)w * wire_bytes, bytes, &alerts[w]);
+            waiting--;
+        }
+        counted[w] = 1;
+        tallied++;
+        tally_add(&tally, &alerts[w], w);
+        coordinator_verdict(&tally, alerts, &verdict);
+    }
 
-        if (alerts[i].attack_flag) {
-            attack_votes++;
+    int *reassigned = NULL;
+    if (tallied < num_reports) {
+        printf("\n[COORDINATOR] Deadline of %d ms reached: verdict from "
+               "%d of %d report(s)\n", cfg->deadline_ms, tallied,
+               num_reports);
+        int reassign = cfg->reassign && cfg->fanout == 0 && !cfg->chunks;
+        reassigned = calloc(num_reports, sizeof(int));
+        for (int w = 0; w < num_reports; w++) {
+            if (counted[w]) {
+                continue;
+            }
+            if (w == num_sources) {
+                printf("  Missing: coordinator share (part_%d.csv)\n",
+                       own.partition);
+                continue;
+            }
+            printf("  Missing: rank %d%s\n", w + 1,
+                   cfg->fanout > 0 ? " and its subtree" : "");
+            if (!reassign || !reassigned) {
+                continue;
+            }
+            /* take the report if it came in while others were redone */
+            MPI_Status status;
+            int arrived = 0;
+            MPI_Test(&requests[w], &arrived, &status);
+            if (arrived) {
+                int bytes = 0;
+                MPI_Get_count(&status, MPI_PACKED, &bytes);
+                alert_unpack(wire + (size_t)w * wire_bytes, bytes,
+                             &alerts[w]);
+                waiting--;
+                printf("  Arrived before reassignment: rank %d\n", w + 1);
+            } else {
+                /* the straggler still reduces its own talkers; drop these */
+                TalkerSummary scratch;
+                talkers_init(&scratch);
+                worker_detect(w + 1, cfg, NULL, 1, &scratch, &alerts[w]);
+                reassigned[w] = 1;
+                printf("  Reassigned: part_%d.csv analyzed by the "
+                       "coordinator\n", w + 1);
+            }
+            counted[w] = 1;
+            tally_add(&tally, &alerts[w], w);
+            coordinator_verdict(&tally, alerts, &verdict);
+        }
+    }
+    verdict_block(&tally, &verdict);
+    blocking_log_flush();
+
+    if (pv) {
+        /* every provisional send was matched before its rank reported */
+        printf("[COORDINATOR] %d provisional alert(s) over %ld records",
+               prov.received, prov.records);
+        if (prov.received > 0) {
+            printf(", first after %.3f ms", prov.first_ms);
+        }
+        printf("; final verdict after %.3f ms\n", get_time_ms() - start_time);
+    }
+
+    /*
+       The verdict is final: log it before waiting on any other rank, so a
+       dead worker cannot hold back the decision or its records.
+    */
+    int global_attack = (verdict.chosen_ip[0] != '\0');
+    if (!global_attack) {
+        printf("\n[COORDINATOR] No global attack detected.\n");
+        printf("  Suspicious votes: %d / %d workers\n",
+               tally.attack_votes, num_ranks);
+    }
+    /*
+       The closing stages are collective over MPI_COMM_WORLD.  They run
+       only if every rank has reported, so a dead worker cannot hang
+       them; with a deadline the workers wait to be told (TAG_FINISH).
+    */
+    int together = waiting == 0;
+    if (cfg->deadline_ms > 0) {
+        finish_notify(world_size, together);
+    }
+    if (!cfg->mpiio_log || !together) {
+        /* log the reports behind the verdict */
+        int logged = 0;
+        for (int w = 0; w < num_reports; w++) {
+            if (counted[w]) {
+                alerts[logged++] = alerts[w];
+            }
+        }
+        append_alert_log(alerts, logged, global_attack, verdict.chosen_ip);
+    }
 
-            /* simple rule: pick first suspicious IP with highest avg_rate */
-            if (chosen_index == -1) {
-                chosen_index = i;
-            } else if (alerts[i].avg_rate > alerts[chosen_index].avg_rate) {
-                chosen_index = i;
+    if (waiting > 0) {
+        /* late reports complete their sends but no longer count */
+        double grace = get_time_ms() + cfg->deadline_ms;
+        while (waiting > 0) {
+            MPI_Status status;
+            int w = coordinator_next(&own, pv, num_sources, requests,
+                                     waiting, grace, &status);
+            if (w < 0) {
+                break;
+            }
+            if (w == num_sources) {
+                printf("[COORDINATOR] Late report from the coordinator "
+                       "share after %.3f ms, not counted\n",
+                       get_time_ms() - start_time);
+                continue;
+            }
+            waiting--;
+            if (reassigned && reassigned[w]) {
+                printf("[COORDINATOR] Late report from rank %d after "
+                       "%.3f ms ignored: part_%d.csv was reassigned\n",
+                       w + 1, get_time_ms() - start_time, w + 1);
+            } else {
+                printf("[COORDINATOR] Late report from rank %d after "
+                       "%.3f ms, not counted\n", w + 1,
+                       get_time_ms() - start_time);
             }
         }
+        /* give up on the rest */
+        for (int w = 0; w < num_sources; w++) {
+            if (requests[w] != MPI_REQUEST_NULL) {
+                printf("[COORDINATOR] No report from rank %d after "
+                       "%.3f ms\n", w + 1, get_time_ms() - start_time);
+                MPI_Cancel(&requests[w]);
+                MPI_Wait(&requests[w], MPI_STATUS_IGNORE);
+            }
+        }
+    }
+    if (own.pending) {
+        /* local work: its talkers and chunk count feed the reductions */
+        MPI_Status status;
+        coordinator_next(&own, pv, num_sources, requests, 0, 0.0, &status);
+        printf("[COORDINATOR] Late report from the coordinator share after "
+               "%.3f ms, not counted\n", get_time_ms() - start_time);
+    }
+    free(reassigned);
+    if (pv) {
+        free(prov.latest);
+        free(prov.seen);
     }
 
-    int global_attack = 0;
-    char chosen_ip[IP_STR_LEN];
-    chosen_ip[0] = '\0';
+    if (!together) {
+        /* the reports behind the verdict are in alerts.csv */
+        printf("[COORDINATOR] Report(s) missing: skipped the global top "
+               "talkers%s%s\n", cfg->chunks ? ", the chunk count" : "",
+               cfg->mpiio_log ? ", the MPI-IO log" : "");
+        free(verdict.blocked);
+        free(wire);
+        free(requests);
+        free(counted);
+        free(alerts);
+        return;
+    }
+
+    TalkerSummary global;
+    talkers_reduce(&own.talkers, &global);
+
+    /* Global top talkers: sources too spread out for any one worker */
+    char hot[MAX_SUSPECTS][IP_STR_LEN];
+    int hot_count = talkers_report(&global, hot, MAX_SUSPECTS);
+    for (int i = 0; i < hot_count; i++) {
+        if (already_blocked(verdict.blocked, verdict.blocked_count, hot[i])) {
+            continue;
+        }
+        printf("[COORDINATOR] Cross-partition heavy hitter CONFIRMED: %s\n",
+               hot[i]);
+        block_ip_once(hot[i], verdict.blocked, &verdict.blocked_count, NULL);
+    }
+    blocking_log_flush();
+
+    if (cfg->chunks) {
+        int busy = 0;
+        int chunks = chunk_counter_free(0, &chunk_win, own.chunks.chunks,
+                                        &busy);
+        printf("[COORDINATOR] dynamic scheduling: %d chunk(s) analyzed "
+               "by %d of %d worker(s)\n", chunks, busy, num_ranks);
+    }
+
+    if (cfg->mpiio_log) {
+        /* each rank writes its own alert; rank 0 its share and verdict */
+        AlertLog log;
+        alert_log_init(&log);
+        if (cfg->coord_worker) {
+            alert_log_add(&log, &own.alert);
+        }
+        alert_log_verdict(&log, 0, global_attack, verdict.chosen_ip);
+        alert_log_write(&log, ALERT_LOG_PATH);
+    }
+    if (verdict.blocked_count > 1) {
+        printf("[COORDINATOR] %d source(s) blocked in total\n",
+               verdict.blocked_count);
+    }
+
+    free(verdict.blocked);
+    free(wire);
+    free(requests);
+    free(counted);
+    free(alerts);
+}
 
-    if (attack_votes >= 2 && chosen_index != -1) {
-        global_attack = 1;
-        strncpy(chosen_ip, alerts[chosen_index].suspicious_ip,
-                IP_STR_LEN - 1);
-        chosen_ip[IP_STR_LEN - 1] = '\0';
+/*
+   Tells every worker whether the closing collectives run.  When they
+   do, every worker has reported and is waiting for this.  Otherwise a
+   straggler may never take the message, so the sends are not waited on
+   and the buffer outlives this call.
+*/
+static void finish_notify(int world_size, int together)
+{
+    static const int skip = 0;
+    for (int r = 1; r < world_size; r++) {
+        if (together) {
+            MPI_Send(&together, 1, MPI_INT, r, TAG_FINISH, MPI_COMM_WORLD);
+        } else {
+            MPI_Request req;
+            MPI_Isend(&skip, 1, MPI_INT, r, TAG_FINISH, MPI_COMM_WORLD,
+                      &req);
+            MPI_Request_free(&req);
+        }
+    }
+}
+
+/*
+   Announces the verdict once the tally reaches two attack votes.  Later
+   reports may raise a stronger candidate, which is reported as a
+   refinement.  Nothing is blocked here: verdict_block acts once, on the
+   final candidate, after the last report is tallied.
+*/
+static void coordinator_verdict(const AlertTally *tally, const Alert *alerts,
+                                Verdict *v)
+{
+    if (tally->attack_votes < 2 || tally->chosen_index == -1) {
+        return;
+    }
+
+    const Alert *chosen = &alerts[tally->chosen_index];
+    if (v->chosen_ip[0] == '\0') {
+        /* verdict as soon as the vote is reached */
+        strncpy(v->chosen_ip, chosen->suspicious_ip, IP_STR_LEN - 1);
+        v->chosen_ip[IP_STR_LEN - 1] = '\0';
 
         printf("\n[COORDINATOR] DDoS attack CONFIRMED.\n");
-        printf("  Suspicious IP (aggregated): %s\n", chosen_ip);
-        printf("  Votes: %d / %d workers\n", attack_votes, num_workers);
-        printf("  Detection methods: Entropy=%d, CUSUM=%d, ML=%d\n",
-               alerts[chosen_index].entropy_detected,
-               alerts[chosen_index].cusum_detected,
-               alerts[chosen_index].ml_detected);
-
-        /* Apply blocking with statistics tracking */
-        BlockingStats block_stats;
-        memset(&block_stats, 0, sizeof(BlockingStats));
-        strncpy(block_stats.blocked_ip, chosen_ip, IP_STR_LEN - 1);
-        
-        double block_start = get_time_ms();
-        apply_rtbh(chosen_ip, &block_stats);
-        apply_acl(chosen_ip, &block_stats);
-        block_stats.block_time_ms = get_time_ms() - block_start;
-        
-        log_blocking_stats(&block_stats, "results/metrics/blocking.csv");
+        printf("  Suspicious IP (aggregated): %s\n", v->chosen_ip);
+        printf("  Votes: %d / %d workers (after %d reports, %.3f ms)\n",
+               tally->attack_votes, v->num_ranks, tally->reports,
+               get_time_ms() - v->start_time);
+        printf("  Detection methods: Entropy=%d, CUSUM=%d, ML=%d, HW=%d, "
+               "Shift=%d, Rate=%d\n",
+               chosen->entropy_detected,
+               chosen->cusum_detected,
+               chosen->ml_detected,
+               chosen->hw_detected,
+               chosen->shift_detected,
+               chosen->rate_detected);
+        printf("  Suspect set: %d source(s)\n", tally->suspect_count);
+        for (int i = 0; i < tally->suspect_count; i++) {
+            printf("    %-16s %10ld pkts %12ld bytes  %d report(s)\n",
+                   tally->suspects[i].ip, tally->suspects[i].packets,
+                   tally->suspects[i].bytes, tally->suspects[i].reports);
+        }
+    } else if (strcmp(v->chosen_ip, chosen->suspicious_ip) != 0) {
+        /* a later report raised a stronger candidate */
+        strncpy(v->chosen_ip, chosen->suspicious_ip, IP_STR_LEN - 1);
+        v->chosen_ip[IP_STR_LEN - 1] = '\0';
+        printf("[COORDINATOR] Candidate refined to %s "
+               "(votes %d, after %d reports)\n",
+               v->chosen_ip, tally->attack_votes, tally->reports);
+    }
+}
+
+/* the one blocking decision of a one-shot verdict */
+static void verdict_block(const AlertTally *tally, Verdict *v)
+{
+    if (v->chosen_ip[0] == '\0') {
+        return;
+    }
+    block_ip_once(v->chosen_ip, v->blocked, &v->blocked_count, NULL);
+    block_suspect_set(tally, v->blocked, &v->blocked_count, NULL);
+}
+
+void tally_init(AlertTally *tally)
+{
+    memset(tally, 0, sizeof(AlertTally));
+    tally->chosen_index = -1;
+}
+
+/*
+   Adds one worker (or merged subtree) alert to the tally.  Among
+   attack votes, the candidate is the alert with the highest avg_rate;
+   their suspect lists merge into the tally's set.
+*/
+void tally_add(AlertTally *tally, const Alert *alert, int index)
+{
+    tally->reports += alert->worker_count;
+    if (alert->attack_votes <= 0) {
+        return;
+    }
+    tally->attack_votes += alert->attack_votes;
+    if (tally->chosen_index == -1 || alert->avg_rate > tally->chosen_rate) {
+        tally->chosen_index = index;
+        tally->chosen_rate = alert->avg_rate;
+    }
+    suspects_merge(tally->suspects, &tally->suspect_count,
+                   alert->suspects, alert->suspect_count);
+}
+
+/*
+   Blocks of the current decision.  Their ACL rules and blocking.csv rows
+   are written by blocking_log_flush, one open of each file however many
+   sources the decision blocked.  Only one thread blocks at a time: the
+   action thread under --threaded, the coordinator's otherwise.
+*/
+static BlockingStats block_records[MAX_BLOCKED_IPS];
+static int block_record_count = 0;
+
+/* RTBH + ACL for one IP; its records wait for blocking_log_flush */
+void block_suspicious_ip(const char *ip)
+{
+    if (block_record_count == MAX_BLOCKED_IPS) {
+        blocking_log_flush();
+    }
+    BlockingStats *block_stats = &block_records[block_record_count++];
+    memset(block_stats, 0, sizeof(BlockingStats));
+    snprintf(block_stats->blocked_ip, IP_STR_LEN, "%s", ip);
+
+    double block_start = get_time_ms();
+    apply_rtbh(ip, block_stats);
+    apply_acl(ip, block_stats);
+    block_stats->block_time_ms = get_time_ms() - block_start;
+}
+
+void blocking_log_flush(void)
+{
+    if (block_record_count == 0) {
+        return;
+    }
+    FILE *fp = fopen("results/metrics/iptables_rules.txt", "a");
+    if (fp) {
+        for (int i = 0; i < block_record_count; i++) {
+            const char *ip = block_records[i].blocked_ip;
+            fprintf(fp, "iptables -A INPUT -s %s -j DROP\n", ip);
+            fprintf(fp, "iptables -A OUTPUT -d %s -j DROP\n", ip);
+        }
+        fclose(fp);
+    }
+    log_blocking_stats(block_records, block_record_count,
+                       "results/metrics/blocking.csv");
+    block_record_count = 0;
+}
+
+int already_blocked(char (*blocked)[IP_STR_LEN], int count, const char *ip)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(blocked[i], ip) == 0) return 1;
+    }
+    return 0;
+}
+
+/*
+   Blocks `ip` unless it is already in `blocked`, and queues it for the
+   workers when a blocklist channel is open.  With --threaded, the rules
+   and the broadcast are left to the coordinator's action and comm
+   threads.  Returns 1 if newly blocked.
+*/
+int block_ip_once(const char *ip, char (*blocked)[IP_STR_LEN],
+                  int *blocked_count, Blocklist *bl)
+{
+    if (ip[0] == '\0' || strcmp(ip, "NONE") == 0 ||
+        *blocked_count >= MAX_BLOCKED_IPS ||
+        already_blocked(blocked, *blocked_count, ip)) {
+        return 0;
+    }
+    strcpy(blocked[(*blocked_count)++], ip);
+    if (bl && bl->async) {
+        coord_threads_block(bl->async, ip);
+        return 1;
+    }
+    block_suspicious_ip(ip);
+    if (bl) {
+        blocklist_announce(bl, ip);
+    }
+    return 1;
+}
+
+/*
+   Blocks the tally's suspect set in one decision.  The candidate is
+   blocked by the caller; other suspects only once SUSPECT_CONFIRM
+   reports named them, so one worker's view cannot block a source.
+*/
+int block_suspect_set(const AlertTally *tally, char (*blocked)[IP_STR_LEN],
+                      int *blocked_count, Blocklist *bl)
+{
+    int added = 0;
+    for (int i = 0; i < tally->suspect_count; i++) {
+        if (tally->suspects[i].reports < SUSPECT_CONFIRM) {
+            continue;
+        }
+        added += block_ip_once(tally->suspects[i].ip, blocked,
+                               blocked_count, bl);
+    }
+    return added;
+}
+
+/* ==============================
+   Coordinator as worker
+   ============================== */
+/*
+   With --coord-worker rank 0 analyzes a share of the data instead of
+   idling in MPI_Waitany, and the share is tallied as one more report:
+
+   - static partitions: a helper thread runs worker_detect on
+     part_<world_size>.csv, so the data is split into world_size parts.
+     The helper makes no MPI calls (MPI_THREAD_FUNNELED); the main
+     thread keeps receiving alerts and polls it between them.
+   - --chunks: the main thread claims and analyzes a chunk whenever no
+     worker alert is waiting, stealing work between aggregation steps.
+*/
+static void *coord_share_thread(void *arg)
+{
+    CoordShare *own = arg;
+    worker_detect(own->partition, own->cfg, NULL, !own->threaded,
+                  &own->talkers, &own->alert);
+    own->alert.worker_rank = 0;
+    __atomic_store_n(&own->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void coord_share_start(CoordShare *own, int world_size,
+                              const DetectorConfig *cfg, MPI_Win chunk_win)
+{
+    memset(own, 0, sizeof(CoordShare));
+    own->cfg = cfg;
+    own->partition = world_size;
+    if (!cfg->coord_worker) {
+        return;
+    }
+    own->pending = 1;
+
+    if (cfg->chunks) {
+        if (chunk_worker_init(&own->chunks, 0, cfg, chunk_win,
+                              &own->talkers, &own->alert) != 0) {
+            own->done = 1;      /* report the empty alert */
+        }
+        return;
+    }
+
+    int level = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&level);
+    /* set before the thread starts: it decides whether to use MPI-IO */
+    own->threaded = level >= MPI_THREAD_FUNNELED;
+    if (own->threaded &&
+        pthread_create(&own->thread, NULL, coord_share_thread, own) == 0) {
+        printf("[COORDINATOR] helper thread analyzing part_%d.csv\n",
+               own->partition);
     } else {
-        printf("\n[COORDINATOR] No global attack detected.\n");
-        printf("  Suspicious votes: %d / %d workers\n",
-               attack_votes, num_workers);
+        own->threaded = 0;
+        fprintf(stderr, "Coordinator: no helper thread, analyzing "
+                        "part_%d.csv before collecting\n", own->partition);
+        coord_share_thread(own);
     }
+}
 
-    append_alert_log(alerts, num_workers, global_attack, chosen_ip);
+/*
+   Returns the index of the next report to tally: a completed receive,
+   or num_sources for the coordinator's own share; -1 once `deadline`
+   (absolute ms, 0 = none) has passed.  While the share is pending, a
+   deadline is set or provisional alerts are expected, receives are
+   polled and the gaps used to claim a chunk or yield the core to the
+   helper thread.
+*/
+static int coordinator_next(CoordShare *own, Provisional *prov,
+                            int num_sources, MPI_Request *requests,
+                            int waiting, double deadline,
+                            MPI_Status *status)
+{
+    for (;;) {
+        if (prov) {
+            provisional_poll(prov);
+        }
+        if (own->pending && __atomic_load_n(&own->done, __ATOMIC_ACQUIRE)) {
+            if (own->threaded) {
+                pthread_join(own->thread, NULL);
+            }
+            own->pending = 0;
+            return num_sources;
+        }
+        if (deadline > 0.0 && get_time_ms() >= deadline) {
+            return -1;
+        }
+        if (waiting > 0) {
+            int w, flag = 1;
+            if (own->pending || deadline > 0.0 || prov) {
+                MPI_Testany(num_sources, requests, &w, &flag, status);
+            } else {
+                MPI_Waitany(num_sources, requests, &w, status);
+            }
+            if (flag) {
+                return w;
+            }
+        } else if (!own->pending) {
+            return -1;          /* nothing left; not reached by the caller */
+        }
+        if (own->pending && own->cfg->chunks) {
+            if (!chunk_worker_step(&own->chunks)) {
+                chunk_worker_finish(&own->chunks);
+                own->done = 1;
+            }
+        } else {
+            sleep_ms(1);
+        }
+    }
+}
 
-    free(alerts);
+/* ==============================
+   Provisional verdicts
+   ============================== */
+/*
+   With --provisional N, workers loading a static partition send rank 0
+   a provisional alert for every N records read (TAG_PROVISIONAL).
+   The coordinator keeps each rank's latest one and re-tallies them on
+   arrival.  It announces a provisional verdict when two ranks' latest
+   alerts vote attack, and again whenever that verdict changes.
+   Provisional verdicts block nothing; the final reports decide.
+*/
+static void provisional_add(Provisional *p, const Alert *a, int source)
+{
+    if (source < 0 || source >= p->world_size) {
+        return;
+    }
+    if (p->received++ == 0) {
+        p->first_ms = get_time_ms() - p->start_time;
+        printf("[COORDINATOR] First provisional alert after %.3f ms "
+               "(rank %d)\n", p->first_ms, source);
+    }
+    /* alerts carry running totals: count each rank's latest only */
+    if (p->seen[source]) {
+        p->records -= p->latest[source].total_flows;
+    }
+    p->latest[source] = *a;
+    p->seen[source] = 1;
+    p->records += a->total_flows;
+
+    AlertTally tally;
+    tally_init(&tally);
+    for (int r = 0; r < p->world_size; r++) {
+        if (p->seen[r]) {
+            tally_add(&tally, &p->latest[r], r);
+        }
+    }
+
+    double at = get_time_ms() - p->start_time;
+    if (tally.attack_votes >= 2 && tally.chosen_index != -1) {
+        const char *ip = p->latest[tally.chosen_index].suspicious_ip;
+        if (!p->attack || strcmp(p->chosen_ip, ip) != 0) {
+            p->attack = 1;
+            strncpy(p->chosen_ip, ip, IP_STR_LEN - 1);
+            p->chosen_ip[IP_STR_LEN - 1] = '\0';
+            printf("[COORDINATOR] Provisional verdict at %.3f ms: attack "
+                   "likely, %s (votes %d / %d rank(s), %ld records)\n",
+                   at, p->chosen_ip, tally.attack_votes, tally.reports,
+                   p->records);
+        }
+    } else if (p->attack) {
+        p->attack = 0;
+        printf("[COORDINATOR] Provisional verdict at %.3f ms: no attack "
+               "(votes %d / %d rank(s), %ld records)\n", at,
+               tally.attack_votes, tally.reports, p->records);
+    }
+}
+
+/* coordinator: takes every provisional alert that has arrived */
+static void provisional_poll(Provisional *prov)
+{
+    for (;;) {
+        int flag = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_PROVISIONAL, MPI_COMM_WORLD, &flag,
+                   &status);
+        if (!flag) {
+            return;
+        }
+        Alert a;
+        alert_recv(&a, status.MPI_SOURCE, TAG_PROVISIONAL, &status);
+        provisional_add(prov, &a, status.MPI_SOURCE);
+    }
 }
 
 /* ==============================
@@ -237,26 +1444,83 @@ void coordinator_start(int world_size, const char *dataset_root)
    Example:
    192.168.1.10,10.0.0.5,512,1700000001,17,60954,29816,2
 */
-static int load_partition(int rank, const char *dataset_root,
-                          FlowRecord *records, int max_records)
+int flow_source_open(FlowSource *src, int rank, const char *dataset_root,
+                     int follow_idle_s)
 {
     char path[512];
-    snprintf(path, sizeof(path),
-             "%s/partitions/part_%d.csv", dataset_root, rank);
+    snprintf(path, sizeof(path), "%s/partitions/part_%d.csv",
+             dataset_root, rank);
 
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
+    if (flow_source_open_path(src, rank, path, follow_idle_s) != 0) {
         fprintf(stderr, "Worker %d: could not open %s\n", rank, path);
-        return 0;
+        return -1;
     }
+    return 0;
+}
+
+/* opens any partition-format file; quiet on failure */
+int flow_source_open_path(FlowSource *src, int rank, const char *path,
+                          int follow_idle_s)
+{
+    memset(src, 0, sizeof(FlowSource));
+    src->rank = rank;
+    src->follow_idle_s = follow_idle_s;
+    snprintf(src->path, sizeof src->path, "%s", path);
+
+    src->fp = fopen(src->path, "r");
+    return src->fp ? 0 : -1;
+}
+
+void sleep_ms(int ms)
+{
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
 
+/*
+   Reads up to max_records parsed records.  Returns 0 at end of input.
+   In follow mode a short read returns whatever arrived so far; an empty
+   read polls for appended lines until follow_idle_s passes with none.
+   A trailing line without its newline is left for the next call.
+*/
+int flow_source_read(FlowSource *src, FlowRecord *records, int max_records)
+{
     char line[1024];
     int count = 0;
-    int header_skipped = 0;
+    double idle_since = get_time_ms();
+
+    if (src->router > 0) {
+        return router_read(src, records, max_records);
+    }
+    if (!src->fp) return 0;
+
+    while (count < max_records) {
+        long line_start = ftell(src->fp);
+
+        if (!fgets(line, sizeof(line), src->fp)) {
+            clearerr(src->fp);
+            if (src->follow_idle_s <= 0 || count > 0) {
+                break;
+            }
+            if (get_time_ms() - idle_since > src->follow_idle_s * 1000.0) {
+                break;
+            }
+            sleep_ms(FOLLOW_POLL_MS);
+            continue;
+        }
+        if (src->follow_idle_s > 0 && strchr(line, '\n') == NULL &&
+            strlen(line) < sizeof(line) - 1) {
+            /* writer is mid-line: retry from the line start later */
+            fseek(src->fp, line_start, SEEK_SET);
+            if (count > 0) break;
+            sleep_ms(FOLLOW_POLL_MS);
+            continue;
+        }
 
-    while (fgets(line, sizeof(line), fp) && count < max_records) {
-        if (!header_skipped) {
-            header_skipped = 1;
+        if (!src->header_skipped) {
+            src->header_skipped = 1;
             continue;
         }
         
@@ -267,15 +1531,26 @@ static int load_partition(int rank, const char *dataset_root,
         memset(&r, 0, sizeof(r));
 
         /* Parse: src_ip,dst_ip,bytes,timestamp,protocol,src_port,dst_port,packets */
-        char src[IP_STR_LEN], dst[IP_STR_LEN];
+        char src_ip[IP_STR_LEN], dst_ip[IP_STR_LEN];
         int bytes = 0, ts = 0, proto = 0, sport = 0, dport = 0, pkts = 0;
 
         int parsed = sscanf(line, "%31[^,],%31[^,],%d,%d,%d,%d,%d,%d",
-                           src, dst, &bytes, &ts, &proto, &sport, &dport, &pkts);
+                           src_ip, dst_ip, &bytes, &ts, &proto, &sport,
+                           &dport, &pkts);
         
+        if (parsed >= 4 && src->filter && src->filter->count > 0) {
+            uint32_t addr;
+            if (ip_to_u32(src_ip, &addr) == 0 &&
+                blockset_contains(src->filter, addr)) {
+                /* residual traffic from an already blocked source */
+                src->filtered_records++;
+                src->filtered_packets += (pkts > 0) ? pkts : 1;
+                continue;
+            }
+        }
         if (parsed >= 4) {
-            strncpy(r.src_ip, src, IP_STR_LEN - 1);
-            strncpy(r.dst_ip, dst, IP_STR_LEN - 1);
+            strncpy(r.src_ip, src_ip, IP_STR_LEN - 1);
+            strncpy(r.dst_ip, dst_ip, IP_STR_LEN - 1);
             r.bytes = bytes;
             r.timestamp = ts;
             r.protocol = proto;
@@ -286,15 +1561,184 @@ static int load_partition(int rank, const char *dataset_root,
         }
     }
 
-    fclose(fp);
+    src->records_read += count;
+    return count;
+}
+
+void flow_source_close(FlowSource *src)
+{
+    if (src->fp) {
+        fclose(src->fp);
+        src->fp = NULL;
+    }
+    free(src->batch);
+    src->batch = NULL;
+}
+
+static int load_partition(int rank, const char *dataset_root,
+                          FlowRecord *records, int max_records)
+{
+    FlowSource src;
+    if (flow_source_open(&src, rank, dataset_root, 0) != 0) {
+        return 0;
+    }
+
+    int count = flow_source_read(&src, records, max_records);
+    flow_source_close(&src);
     
     if (count > 0) {
-        printf("Worker %d: loaded %d records from %s\n", rank, count, path);
+        printf("Worker %d: loaded %d records from %s\n",
+               rank, count, src.path);
     }
     
     return count;
 }
 
+/* partition `part` (1-based, as part_<part>.csv) of the raw CSV */
+static int load_raw_slice(int part, const DetectorConfig *cfg, int mpi_io,
+                          FlowRecord *records, int max_records)
+{
+    long lo = 0, hi = 0;
+    int count = raw_csv_load(cfg->raw_input, part - 1, cfg->raw_slices,
+                             mpi_io, records, max_records, &lo, &hi);
+    if (count < 0) {
+        fprintf(stderr, "Worker %d: could not open %s\n", part,
+                cfg->raw_input);
+        return 0;
+    }
+    if (count > 0) {
+        printf("Worker %d: loaded %d records from bytes [%ld, %ld) of %s%s\n",
+               part, count, lo, hi, cfg->raw_input,
+               count == max_records ? " (truncated)" : "");
+    }
+    return count;
+}
+
+/*
+   load_partition with a provisional alert after every cfg->provisional
+   records.  Every block goes through the detectors, which share one
+   context so CUSUM and Holt-Winters carry over as in stream mode, and
+   its per-IP stats are folded into running totals.  The alert sent
+   carries the latest block's votes with features and suspects over
+   everything read so far.  The final alert is still computed over the
+   whole partition with a fresh context.
+
+   Sends are synchronous (MPI_Issend) and at most one is in flight.  A
+   block whose turn comes while the previous send is unmatched is still
+   analyzed, only not reported, and the last send completes before the
+   loader returns.  By the time this rank's final alert goes out, the
+   coordinator has taken all of its provisional alerts.
+*/
+static int load_partition_provisional(int rank, const DetectorConfig *cfg,
+                                      FlowRecord *records, int max_records)
+{
+    FlowSource src;
+    if (flow_source_open(&src, rank, cfg->dataset_root, 0) != 0) {
+        return 0;
+    }
+
+    int wire_bytes = wire_max_bytes();
+    IpStat *stats = malloc(sizeof(IpStat) * MAX_UNIQUE_IPS);
+    IpStat *totals = malloc(sizeof(IpStat) * MAX_UNIQUE_IPS);
+    char *wire = malloc(wire_bytes);
+    if (!stats || !totals || !wire) {
+        free(wire);
+        free(totals);
+        free(stats);
+        flow_source_close(&src);
+        return load_partition(rank, cfg->dataset_root, records, max_records);
+    }
+    DetectorContext detectors;
+    CascadeStats cascade;
+    detector_context_init(&detectors, cfg);
+    memset(&cascade, 0, sizeof(CascadeStats));
+
+    /* running totals over every block read so far */
+    int total_count = 0;
+    int run_packets = 0;
+    long run_bytes = 0;
+    int min_ts = 0, max_ts = 0;
+
+    MPI_Request req = MPI_REQUEST_NULL;
+    int count = 0, blocks = 0, sent = 0, skipped = 0;
+    double start_time = get_time_ms();
+    while (count < max_records) {
+        int want = max_records - count;
+        if (want > cfg->provisional) {
+            want = cfg->provisional;
+        }
+        int n = flow_source_read(&src, records + count, want);
+        if (n <= 0) {
+            break;
+        }
+        count += n;
+        if (n < want) {
+            break;              /* end of partition: the final alert follows */
+        }
+
+        const FlowRecord *block = records + count - n;
+        Alert alert;
+        int stat_count = analyze_window(&detectors, block, n, stats, rank,
+                                        blocks++, &cascade, &alert);
+        for (int i = 0; i < stat_count; i++) {
+            int idx = find_or_add_ip(totals, &total_count, stats[i].ip);
+            if (idx >= 0) {
+                totals[idx].packet_count += stats[i].packet_count;
+                totals[idx].byte_count   += stats[i].byte_count;
+            }
+        }
+        if (run_packets == 0) {
+            min_ts = max_ts = block[0].timestamp;
+        }
+        for (int i = 0; i < n; i++) {
+            run_bytes += block[i].bytes;
+            if (block[i].timestamp < min_ts) min_ts = block[i].timestamp;
+            if (block[i].timestamp > max_ts) max_ts = block[i].timestamp;
+        }
+        run_packets += n;
+
+        int done = 1;
+        MPI_Test(&req, &done, MPI_STATUS_IGNORE);
+        if (!done) {
+            skipped++;
+            continue;
+        }
+        Features feats;
+        compute_features(totals, total_count, run_packets, run_bytes,
+                         min_ts, max_ts, &feats);
+        alert.window_id     = sent;
+        alert.entropy       = feats.entropy;
+        alert.avg_rate      = feats.avg_rate;
+        alert.spike_score   = feats.spike_score;
+        alert.total_packets = feats.total_packets;
+        alert.total_flows   = feats.total_flows;
+        if (alert.attack_flag) {
+            alert.suspect_count = select_suspects(totals, total_count,
+                                                  alert.suspicious_ip,
+                                                  alert.suspects);
+        }
+        alert.processing_time_ms = get_time_ms() - start_time;
+        int bytes = alert_pack(&alert, wire, wire_bytes);
+        MPI_Issend(wire, bytes, MPI_PACKED, 0, TAG_PROVISIONAL,
+                   MPI_COMM_WORLD, &req);
+        sent++;
+    }
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+
+    flow_source_close(&src);
+    detector_context_free(&detectors);
+    free(wire);
+    free(totals);
+    free(stats);
+
+    if (count > 0) {
+        printf("Worker %d: loaded %d records from %s, %d provisional "
+               "alert(s) sent, %d block(s) analyzed but not sent while "
+               "one was in flight\n", rank, count, src.path, sent, skipped);
+    }
+    return count;
+}
+
 /* ==============================
    IP stats & feature extraction
    ============================== */
@@ -317,11 +1761,19 @@ static int find_or_add_ip(IpStat *stats, int *stat_count, const char *ip)
     return idx;
 }
 
-static void build_ip_stats(FlowRecord *records, int count,
+/* multiplicative hash keeps popular ports (53, 123, 389...) apart */
+static inline int port_bin(int port)
+{
+    return (int)(((unsigned)port * 2654435761u) >> 26) & (HIST_PORT_BINS - 1);
+}
+
+static void build_ip_stats(const FlowRecord *records, int count,
                            IpStat *stats, int *stat_count,
+                           TrafficHistograms *hist,
                            int *total_packets, long *total_bytes,
                            int *min_ts, int *max_ts)
 {
+    memset(hist, 0, sizeof(TrafficHistograms));
     *stat_count = 0;
     *total_packets = 0;
     *total_bytes = 0;
@@ -334,7 +1786,7 @@ static void build_ip_stats(FlowRecord *records, int count,
     *max_ts = records[0].timestamp;
 
     for (int i = 0; i < count; i++) {
-        FlowRecord *r = &records[i];
+        const FlowRecord *r = &records[i];
 
         int idx = find_or_add_ip(stats, stat_count, r->src_ip);
         if (idx >= 0) {
@@ -342,6 +1794,11 @@ static void build_ip_stats(FlowRecord *records, int count,
             stats[idx].byte_count   += r->bytes;
         }
 
+        hist->src_port[port_bin(r->src_port)]++;
+        hist->dst_port[port_bin(r->dst_port)]++;
+        hist->protocol[r->protocol & (HIST_PROTO_BINS - 1)]++;
+        hist->total++;
+
         *total_packets += 1;
         *total_bytes   += r->bytes;
 
@@ -394,6 +1851,7 @@ static void compute_features(IpStat *stats, int stat_count,
     out_feats->total_packets = total_packets;
     out_feats->total_flows   = total_packets; /* here each record ~1 pkt */
     out_feats->unique_ips    = stat_count;
+    out_feats->packet_size_mean = (double)total_bytes / (double)total_packets;
 }
 
 /* ==============================
@@ -462,6 +1920,145 @@ static int detect_cusum_anomaly(const Features *f, CusumState *cusum)
     return 0;
 }
 
+static void init_hw_state(HoltWintersState *hw, int season_len)
+{
+    memset(hw, 0, sizeof(HoltWintersState));
+    if (season_len < 1) season_len = 1;
+    if (season_len > HW_MAX_SEASON) season_len = HW_MAX_SEASON;
+    hw->season_len = season_len;
+    hw->alpha = 0.3;
+    hw->beta  = 0.05;
+    hw->gamma = 0.2;
+}
+
+/*
+   Holt-Winters: forecast the packet rate from level + trend + the
+   seasonal offset for this phase, and flag when the observation exceeds
+   the forecast by more than 3 smoothed standard deviations.  The first
+   two seasons only train the model.  Observations fed back into the
+   state are clamped to the band so an attack cannot become the baseline.
+*/
+static int detect_hw_anomaly(const Features *f, HoltWintersState *hw)
+{
+    const double k = 3.0;
+    double x = f->avg_rate;
+    int pos = hw->pos;
+
+    if (hw->samples == 0) {
+        hw->level = x;
+    }
+
+    if (hw->samples < hw->season_len) {
+        /* first season: seasonal offsets relative to the first level */
+        hw->season[pos] = x - hw->level;
+        hw->samples++;
+        hw->pos = (pos + 1) % hw->season_len;
+        return 0;
+    }
+
+    double forecast = hw->level + hw->trend + hw->season[pos];
+    double sigma = sqrt(hw->resid_var);
+    double resid = x - forecast;
+    int anomaly = 0;
+
+    if (hw->samples >= 2L * hw->season_len && resid > k * sigma + 1e-9) {
+        anomaly = 1;
+    }
+    if (hw->samples >= 2L * hw->season_len) {
+        if (x > forecast + k * sigma) x = forecast + k * sigma;
+        if (x < forecast - k * sigma) x = forecast - k * sigma;
+        resid = x - forecast;
+    }
+
+    double prev_level = hw->level;
+    hw->level = hw->alpha * (x - hw->season[pos]) +
+                (1.0 - hw->alpha) * (hw->level + hw->trend);
+    hw->trend = hw->beta * (hw->level - prev_level) +
+                (1.0 - hw->beta) * hw->trend;
+    hw->season[pos] = hw->gamma * (x - hw->level) +
+                      (1.0 - hw->gamma) * hw->season[pos];
+    hw->resid_var = 0.9 * hw->resid_var + 0.1 * resid * resid;
+
+    hw->samples++;
+    hw->pos = (pos + 1) % hw->season_len;
+    return anomaly;
+}
+
+static void init_shift_state(ShiftState *shift)
+{
+    memset(shift, 0, sizeof(ShiftState));
+    shift->decay = 0.1;
+    shift->threshold = 1.0;
+}
+
+/* KL(window || baseline) over one histogram; epsilon keeps log finite */
+static double hist_kl(const long *counts, long total,
+                      const double *baseline, int bins)
+{
+    const double eps = 1e-6;
+    double kl = 0.0;
+    for (int b = 0; b < bins; b++) {
+        if (counts[b] == 0) continue;
+        double p = (double)counts[b] / (double)total;
+        kl += p * log(p / (baseline[b] + eps));
+    }
+    return kl;
+}
+
+static void hist_blend(const long *counts, long total, double *baseline,
+                       int bins, double weight)
+{
+    for (int b = 0; b < bins; b++) {
+        double p = (double)counts[b] / (double)total;
+        baseline[b] = (1.0 - weight) * baseline[b] + weight * p;
+    }
+}
+
+/*
+   Distribution shift: summed KL divergence of the window's source-port,
+   destination-port and protocol mix against an exponentially weighted
+   baseline.  O(bins) per window, independent of traffic volume.  The
+   first window seeds the baseline; flagged windows are not blended in.
+*/
+static int detect_shift_anomaly(const TrafficHistograms *hist,
+                                ShiftState *shift)
+{
+    shift->last_score = 0.0;
+    if (hist->total <= 0) {
+        return 0;
+    }
+
+    if (shift->windows == 0) {
+        hist_blend(hist->src_port, hist->total, shift->src_port,
+                   HIST_PORT_BINS, 1.0);
+        hist_blend(hist->dst_port, hist->total, shift->dst_port,
+                   HIST_PORT_BINS, 1.0);
+        hist_blend(hist->protocol, hist->total, shift->protocol,
+                   HIST_PROTO_BINS, 1.0);
+        shift->windows++;
+        return 0;
+    }
+
+    double score =
+        hist_kl(hist->src_port, hist->total, shift->src_port, HIST_PORT_BINS) +
+        hist_kl(hist->dst_port, hist->total, shift->dst_port, HIST_PORT_BINS) +
+        hist_kl(hist->protocol, hist->total, shift->protocol, HIST_PROTO_BINS);
+    shift->last_score = score;
+    shift->windows++;
+
+    if (score > shift->threshold) {
+        return 1;
+    }
+
+    hist_blend(hist->src_port, hist->total, shift->src_port,
+               HIST_PORT_BINS, shift->decay);
+    hist_blend(hist->dst_port, hist->total, shift->dst_port,
+               HIST_PORT_BINS, shift->decay);
+    hist_blend(hist->protocol, hist->total, shift->protocol,
+               HIST_PROTO_BINS, shift->decay);
+    return 0;
+}
+
 /* Simple ML-based detection (logistic regression style) */
 static int detect_ml_anomaly(const Features *f, MLDetector *ml)
 {
@@ -484,6 +2081,19 @@ static int detect_ml_anomaly(const Features *f, MLDetector *ml)
     return (prob > ml->threshold) ? 1 : 0;
 }
 
+/* Tree-ensemble detection: mean leaf vote over all trees */
+static int detect_forest_anomaly(const Features *f,
+                                 const TreeEnsemble *forest)
+{
+    float vec[ML_FEATURES];
+    float score = 0.0f;
+
+    forest_feature_vector(f, vec);
+    forest_predict_batch(forest, vec, 1, &score);
+
+    return (score > forest->threshold) ? 1 : 0;
+}
+
 /* entropy check: if entropy drops below threshold, traffic is skewed */
 static int detect_entropy_anomaly(const Features *f)
 {
@@ -509,7 +2119,7 @@ static int detect_rate_anomaly(const Features *f)
 }
 
 /* hot IP check: if single IP dominates traffic */
-static int detect_hot_ip(IpStat *stats, int stat_count,
+static int detect_hot_ip(const IpStat *stats, int stat_count,
                          int total_packets, char *out_ip)
 {
     if (total_packets <= 0 || stat_count <= 0) {
@@ -537,6 +2147,359 @@ static int detect_hot_ip(IpStat *stats, int stat_count,
     return 0;
 }
 
+/* ==============================
+   Detector registry & pipelines
+   ============================== */
+#if defined(__GNUC__)
+#define PIPELINE_INLINE static inline __attribute__((always_inline))
+#else
+#define PIPELINE_INLINE static inline
+#endif
+
+/* --- per-detector adapters: name_init / name_score_window / name_score_ip */
+static void entropy_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    (void)ctx; (void)cfg;
+}
+
+static int entropy_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    (void)ctx;
+    return detect_entropy_anomaly(in->feats);
+}
+
+/* low entropy means a few sources dominate: report the dominant one */
+static int entropy_score_ip(DetectorContext *ctx, const WindowInput *in,
+                            char *out_ip)
+{
+    (void)ctx;
+    return detect_hot_ip(in->stats, in->stat_count, in->total_packets,
+                         out_ip);
+}
+
+static void rate_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    (void)ctx; (void)cfg;
+}
+
+static int rate_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    (void)ctx;
+    return detect_rate_anomaly(in->feats);
+}
+
+/* high rate without a dominant source: report the top talker */
+static int rate_score_ip(DetectorContext *ctx, const WindowInput *in,
+                         char *out_ip)
+{
+    (void)ctx;
+    if (in->feats->top_ip[0] == '\0') {
+        return 0;
+    }
+    strncpy(out_ip, in->feats->top_ip, IP_STR_LEN - 1);
+    out_ip[IP_STR_LEN - 1] = '\0';
+    return 1;
+}
+
+static void cusum_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    (void)cfg;
+    init_cusum_state(&ctx->cusum);
+}
+
+static int cusum_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    return detect_cusum_anomaly(in->feats, &ctx->cusum);
+}
+
+/* the history and cumulative sums advance on every window */
+static void cusum_update(DetectorContext *ctx, const WindowInput *in)
+{
+    detect_cusum_anomaly(in->feats, &ctx->cusum);
+}
+
+static void hw_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    init_hw_state(&ctx->hw, cfg->hw_season);
+}
+
+static int hw_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    return detect_hw_anomaly(in->feats, &ctx->hw);
+}
+
+/* one step per window keeps the seasonal phase on the real windows */
+static void hw_update(DetectorContext *ctx, const WindowInput *in)
+{
+    detect_hw_anomaly(in->feats, &ctx->hw);
+}
+
+static void shift_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    (void)cfg;
+    init_shift_state(&ctx->shift);
+}
+
+static int shift_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    return detect_shift_anomaly(in->hist, &ctx->shift);
+}
+
+/* benign windows keep blending into the baseline */
+static void shift_update(DetectorContext *ctx, const WindowInput *in)
+{
+    detect_shift_anomaly(in->hist, &ctx->shift);
+}
+
+static void ml_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    init_ml_detector(&ctx->ml);
+    if (cfg->forest_model &&
+        forest_load_model(cfg->forest_model, &ctx->forest) != 0) {
+        fprintf(stderr, "Forest: falling back to logistic ML detector\n");
+    }
+}
+
+static int ml_score_window(DetectorContext *ctx, const WindowInput *in)
+{
+    return ctx->forest.loaded ?
+           detect_forest_anomaly(in->feats, &ctx->forest) :
+           detect_ml_anomaly(in->feats, &ctx->ml);
+}
+
+/* detectors without per-IP scoring */
+#define NO_IP_SCORE(name)                                               \
+static int name##_score_ip(DetectorContext *ctx, const WindowInput *in, \
+                           char *out_ip)                                \
+{                                                                       \
+    (void)ctx; (void)in; (void)out_ip;                                  \
+    return 0;                                                           \
+}
+NO_IP_SCORE(cusum)
+NO_IP_SCORE(hw)
+NO_IP_SCORE(shift)
+NO_IP_SCORE(ml)
+#undef NO_IP_SCORE
+
+/* stateless detectors: a skipped window leaves nothing to advance */
+#define NO_UPDATE(name)                                                 \
+static void name##_update(DetectorContext *ctx, const WindowInput *in)  \
+{                                                                       \
+    (void)ctx; (void)in;                                                \
+}
+NO_UPDATE(entropy)
+NO_UPDATE(rate)
+NO_UPDATE(ml)
+#undef NO_UPDATE
+
+static const DetectorOps registry[DET_COUNT] = {
+#define X(ID, name) \
+    { #name, DET_MASK(ID), name##_init, name##_score_window, name##_update, \
+      name##_score_ip },
+    DETECTOR_LIST(X)
+#undef X
+};
+
+const DetectorOps *detector_registry(int *count)
+{
+    if (count) *count = DET_COUNT;
+    return registry;
+}
+
+/* "entropy,cusum,ml" -> mask; 0 if any name is unknown */
+unsigned detector_mask_from_names(const char *list)
+{
+    char buf[256];
+    unsigned mask = 0;
+
+    strncpy(buf, list, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        int found = 0;
+        for (int i = 0; i < DET_COUNT; i++) {
+            if (strcmp(tok, registry[i].name) == 0) {
+                mask |= registry[i].mask;
+                found = 1;
+            }
+        }
+        if (!found) {
+            return 0;
+        }
+    }
+    return mask;
+}
+
+void detector_context_init(DetectorContext *ctx, const DetectorConfig *cfg)
+{
+    memset(ctx, 0, sizeof(DetectorContext));
+    ctx->mask = cfg->detector_mask ? cfg->detector_mask : DET_DEFAULT_MASK;
+    ctx->cascade = cfg->cascade;
+    ctx->pipeline = PIPELINE_GENERIC;
+
+#define X(pname, pmask) \
+    if (ctx->pipeline == PIPELINE_GENERIC && ctx->mask == (pmask)) \
+        ctx->pipeline = PIPELINE_##pname;
+    PIPELINE_LIST(X)
+#undef X
+
+    for (int i = 0; i < DET_COUNT; i++) {
+        if (ctx->mask & registry[i].mask) {
+            registry[i].init(ctx, cfg);
+        }
+    }
+}
+
+void detector_context_free(DetectorContext *ctx)
+{
+    forest_free(&ctx->forest);
+}
+
+/* decided once the threshold is reached or out of reach */
+#define CASCADE_DECIDED(votes, left) \
+    ((votes) >= VOTE_THRESHOLD || (votes) + (left) < VOTE_THRESHOLD)
+
+static int mask_popcount(unsigned mask)
+{
+    int n = 0;
+    for (; mask; mask &= mask - 1) n++;
+    return n;
+}
+
+/*
+   Pipeline body shared by every specialization.  With `mask` and
+   `cascade` constant, each enabled detector is a direct (inlinable) call
+   and disabled ones compile away.  In cascade mode detectors run in
+   registry order and stop voting once the vote is decided; per-IP
+   scoring only runs for windows that end up suspicious.  Detectors past
+   the decision still get their state update, so CUSUM sums, the
+   Holt-Winters phase and the shift baseline follow every window.
+*/
+PIPELINE_INLINE int pipeline_body(DetectorContext *ctx, const WindowInput *in,
+                                  const unsigned mask, const int cascade,
+                                  int *flags, char *out_ip,
+                                  CascadeStats *stats)
+{
+    int votes = 0;
+    int left = mask_popcount(mask);
+
+    stats->windows++;
+
+#define X(ID, name)                                              \
+    if ((mask & DET_MASK(ID)) &&                                 \
+        !(cascade && CASCADE_DECIDED(votes, left))) {            \
+        stats->stage_runs[DET_##ID##_BIT]++;                     \
+        flags[DET_##ID##_BIT] = name##_score_window(ctx, in);    \
+        votes += flags[DET_##ID##_BIT];                          \
+        left--;                                                  \
+    } else if (mask & DET_MASK(ID)) {                            \
+        name##_update(ctx, in);                                  \
+    }
+    DETECTOR_LIST(X)
+#undef X
+
+    if (cascade && votes < VOTE_THRESHOLD) {
+        return votes;
+    }
+    stats->hot_ip_runs++;
+
+#define X(ID, name)                                              \
+    if ((mask & DET_MASK(ID)) && out_ip[0] == '\0') {            \
+        name##_score_ip(ctx, in, out_ip);                        \
+    }
+    DETECTOR_LIST(X)
+#undef X
+
+    return votes;
+}
+
+#define X(pname, pmask)                                                   \
+static int pipeline_##pname##_all(DetectorContext *ctx,                   \
+                                  const WindowInput *in, int *flags,      \
+                                  char *out_ip, CascadeStats *stats)      \
+{                                                                         \
+    return pipeline_body(ctx, in, (pmask), 0, flags, out_ip, stats);      \
+}                                                                         \
+static int pipeline_##pname##_cascade(DetectorContext *ctx,               \
+                                      const WindowInput *in, int *flags,  \
+                                      char *out_ip, CascadeStats *stats)  \
+{                                                                         \
+    return pipeline_body(ctx, in, (pmask), 1, flags, out_ip, stats);      \
+}
+PIPELINE_LIST(X)
+#undef X
+
+/* arbitrary combinations: same semantics, dispatched through the registry */
+static int pipeline_generic(DetectorContext *ctx, const WindowInput *in,
+                            int *flags, char *out_ip, CascadeStats *stats)
+{
+    int votes = 0;
+    int left = mask_popcount(ctx->mask);
+
+    stats->windows++;
+    for (int i = 0; i < DET_COUNT; i++) {
+        if (!(ctx->mask & registry[i].mask)) continue;
+        if (ctx->cascade && CASCADE_DECIDED(votes, left)) {
+            registry[i].update(ctx, in);
+            continue;
+        }
+        stats->stage_runs[i]++;
+        flags[i] = registry[i].score_window(ctx, in);
+        votes += flags[i];
+        left--;
+    }
+
+    if (ctx->cascade && votes < VOTE_THRESHOLD) {
+        return votes;
+    }
+    stats->hot_ip_runs++;
+    for (int i = 0; i < DET_COUNT && out_ip[0] == '\0'; i++) {
+        if (ctx->mask & registry[i].mask) {
+            registry[i].score_ip(ctx, in, out_ip);
+        }
+    }
+    return votes;
+}
+
+int run_detectors(DetectorContext *ctx, const WindowInput *in,
+                  int *flags, char *out_ip, CascadeStats *stats)
+{
+    memset(flags, 0, sizeof(int) * DET_COUNT);
+    out_ip[0] = '\0';
+    ctx->shift.last_score = 0.0;
+
+    switch (ctx->pipeline) {
+#define X(pname, pmask)                                                   \
+    case PIPELINE_##pname:                                                \
+        return ctx->cascade ?                                             \
+               pipeline_##pname##_cascade(ctx, in, flags, out_ip, stats) : \
+               pipeline_##pname##_all(ctx, in, flags, out_ip, stats);
+    PIPELINE_LIST(X)
+#undef X
+    default:
+        return pipeline_generic(ctx, in, flags, out_ip, stats);
+    }
+}
+
+void print_cascade_stats(int rank, const CascadeStats *cascade)
+{
+    int w = cascade->windows > 0 ? cascade->windows : 1;
+    char line[512];
+    int len = 0;
+
+    for (int i = 0; i < DET_COUNT; i++) {
+        if (cascade->stage_runs[i] == 0) continue;
+        len += snprintf(line + len, sizeof(line) - len, " %s=%d (%.1f%%)",
+                        registry[i].name, cascade->stage_runs[i],
+                        100.0 * cascade->stage_runs[i] / w);
+    }
+    line[len] = '\0';
+
+    printf("Worker %d: cascade over %d window(s):%s per-ip=%d (%.1f%%)\n",
+           rank, cascade->windows, line, cascade->hot_ip_runs,
+           100.0 * cascade->hot_ip_runs / w);
+}
+
 /* ==============================
    Blocking simulation
    ============================== */
@@ -552,14 +2515,9 @@ static void apply_rtbh(const char *ip, BlockingStats *stats)
 
 static void apply_acl(const char *ip, BlockingStats *stats)
 {
+    (void)stats;
     printf("[ACL ] Installing drop rule for IP: %s\n", ip);
-    /* Simulate iptables rule installation */
-    FILE *fp = fopen("results/metrics/iptables_rules.txt", "a");
-    if (fp) {
-        fprintf(fp, "iptables -A INPUT -s %s -j DROP\n", ip);
-        fprintf(fp, "iptables -A OUTPUT -d %s -j DROP\n", ip);
-        fclose(fp);
-    }
+    /* Simulated iptables rules are written by blocking_log_flush */
 }
 
 /* ==============================
@@ -623,25 +2581,27 @@ void log_performance_metrics(const PerformanceMetrics *metrics, const char *file
     fclose(fp);
 }
 
-void log_blocking_stats(const BlockingStats *stats, const char *filename)
+void log_blocking_stats(const BlockingStats *stats, int count,
+                        const char *filename)
 {
     FILE *fp = fopen(filename, "a");
     if (!fp) return;
     
-    fprintf(fp, "%s,%d,%d,%.3f,%.3f,%.3f\n",
-            stats->blocked_ip,
-            stats->attack_packets_blocked,
-            stats->legitimate_packets_blocked,
-            stats->blocking_efficiency,
-            stats->collateral_damage,
-            stats->block_time_ms);
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "%s,%d,%d,%.3f,%.3f,%.3f\n",
+                stats[i].blocked_ip,
+                stats[i].attack_packets_blocked,
+                stats[i].legitimate_packets_blocked,
+                stats[i].blocking_efficiency,
+                stats[i].collateral_damage,
+                stats[i].block_time_ms);
+    }
     
     fclose(fp);
 }
 
-static void append_alert_log(const Alert *alerts, int num_alerts,
-                             int global_attack_flag,
-                             const char *chosen_ip)
+void append_alert_log(const Alert *alerts, int num_alerts,
+                      int global_attack_flag, const char *chosen_ip)
 {
     FILE *fp = fopen("results/metrics/alerts.csv", "a");
     if (!fp) {
@@ -650,23 +2610,7 @@ static void append_alert_log(const Alert *alerts, int num_alerts,
     }
 
     for (int i = 0; i < num_alerts; i++) {
-        fprintf(fp,
-                "%d,%d,%s,%.3f,%.3f,%.3f,%d,%d,%d,%d,%d,%.3f,%ld,%d,%s\n",
-                alerts[i].worker_rank,
-                alerts[i].attack_flag,
-                alerts[i].suspicious_ip,
-                alerts[i].entropy,
-                alerts[i].avg_rate,
-                alerts[i].spike_score,
-                alerts[i].total_packets,
-                alerts[i].total_flows,
-                alerts[i].entropy_detected,
-                alerts[i].cusum_detected,
-                alerts[i].ml_detected,
-                alerts[i].processing_time_ms,
-                alerts[i].memory_used_kb,
-                global_attack_flag,
-                (chosen_ip && chosen_ip[0]) ? chosen_ip : "NONE");
+        alert_csv_row(fp, &alerts[i], global_attack_flag, chosen_ip);
     }
 
     fclose(fp);
@@ -1,6 +1,9 @@
 #ifndef DETECTOR_H
 #define DETECTOR_H
 
+#include <mpi.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <sys/time.h>
 
 #define MAX_FLOWS        100000
@@ -8,6 +11,81 @@
 #define IP_STR_LEN          32
 #define CUSUM_WINDOW       100
 #define ML_FEATURES         10
+#define FOREST_MAX_TREES    64
+#define FOREST_MAX_NODES  8192
+#define FOREST_MAX_DEPTH    16
+#define VOTE_THRESHOLD       2   /* detector votes needed to flag attack */
+#define HW_MAX_SEASON      288   /* e.g. 5-minute windows over one day */
+#define HW_DEFAULT_SEASON   24
+#define STREAM_WINDOW       10000   /* default records per streaming window */
+#define STREAM_SLOTS          64   /* windows the coordinator keeps open */
+#define FOLLOW_POLL_MS       100
+#define MAX_BLOCKED_IPS     4096
+#define HIST_PORT_BINS      64   /* hashed source/destination port bins */
+#define HIST_PROTO_BINS     32   /* protocol number & 31 (TCP/UDP/ICMP distinct) */
+#define MAX_SUSPECTS        16   /* top-K suspect sources carried per alert */
+#define SUSPECT_SHARE     0.10   /* suspect: >= 10% of the window's packets */
+#define SUSPECT_RATIO     0.5    /* ...and >= half the primary's packets */
+#define SUSPECT_CONFIRM      2   /* reports naming a suspect before blocking */
+#define TALKER_SLOTS       128   /* heavy hitters kept per talker summary */
+#define TALKER_BUCKETS    1024   /* hashed source bins for global entropy */
+#define BLOCKSET_BITS       13   /* 8192 slots, >= 2 x MAX_BLOCKED_IPS */
+#define BLOCKSET_SLOTS   (1 << BLOCKSET_BITS)
+#define CIC_MAX_LINE      4096   /* longest CIC-DDoS2019 CSV row */
+#define RAW_READ_BLOCK (1 << 20) /* bytes per MPI_File_read_at of a raw CSV */
+#define ROUTER_BATCH      1024   /* records per router -> worker batch */
+#define ROUTER_CREDITS       4   /* batches in flight per worker */
+#define RING_VNODES         32   /* hash-ring points per worker */
+#define RING_MAX_MOVES      16   /* range handoffs queued per worker */
+#define HOT_KEY_SLOTS       32   /* space-saving counters for hot sources */
+#define HOT_KEY_MAX          8   /* sources split at once */
+#define HOT_KEY_CHECK     8192   /* records between hot-key checks */
+#define HOT_KEY_LOAD       1.0   /* hot: >= a whole worker's fair share */
+#define BLOCK_DELTA_MAX     64   /* IPs per blocklist broadcast */
+#define BLOCK_INFLIGHT       4   /* outstanding coordinator broadcasts */
+
+/*
+   Detector registry, in cascade order (cheapest first).  Each entry
+   X(ID, name) expects name_init / name_score_window / name_update /
+   name_score_ip in detector.c and an Alert field name_detected.
+*/
+#define DETECTOR_LIST(X)  \
+    X(ENTROPY, entropy)   \
+    X(RATE,    rate)      \
+    X(CUSUM,   cusum)     \
+    X(HW,      hw)        \
+    X(SHIFT,   shift)     \
+    X(ML,      ml)
+
+enum {
+#define X(ID, name) DET_##ID##_BIT,
+    DETECTOR_LIST(X)
+#undef X
+    DET_COUNT
+};
+
+#define DET_MASK(ID)  (1u << DET_##ID##_BIT)
+#define DET_DEFAULT_MASK (DET_MASK(ENTROPY) | DET_MASK(CUSUM) | \
+                          DET_MASK(HW) | DET_MASK(SHIFT) | DET_MASK(ML))
+
+/*
+   Detector combinations with a compile-time specialized pipeline: the
+   mask is a constant, so disabled detectors and the dispatch through
+   the registry disappear from the per-window path.  Any other
+   combination falls back to the registry loop.
+*/
+#define PIPELINE_LIST(X)                                               \
+    X(default, DET_DEFAULT_MASK)                                       \
+    X(classic, DET_MASK(ENTROPY) | DET_MASK(CUSUM) | DET_MASK(ML))     \
+    X(volume,  DET_MASK(ENTROPY) | DET_MASK(RATE) | DET_MASK(CUSUM) |  \
+               DET_MASK(HW))
+
+enum {
+#define X(pname, pmask) PIPELINE_##pname,
+    PIPELINE_LIST(X)
+#undef X
+    PIPELINE_GENERIC
+};
 
 typedef struct {
     char src_ip[IP_STR_LEN];
@@ -54,6 +132,40 @@ typedef struct {
     double history[CUSUM_WINDOW];
 } CusumState;
 
+/* Holt-Winters (additive triple exponential smoothing) rate baseline.
+   Fixed size per tracked key regardless of how long it runs. */
+typedef struct {
+    double level;
+    double trend;
+    double season[HW_MAX_SEASON];
+    double resid_var;       /* smoothed squared one-step forecast error */
+    double alpha;           /* level smoothing */
+    double beta;            /* trend smoothing */
+    double gamma;           /* seasonal smoothing */
+    int season_len;
+    int pos;                /* phase within the current season */
+    long samples;
+} HoltWintersState;
+
+/* Per-window port/protocol histograms, filled during build_ip_stats */
+typedef struct {
+    long src_port[HIST_PORT_BINS];
+    long dst_port[HIST_PORT_BINS];
+    long protocol[HIST_PROTO_BINS];
+    long total;
+} TrafficHistograms;
+
+/* Rolling baseline distributions for the distribution-shift detector */
+typedef struct {
+    double src_port[HIST_PORT_BINS];
+    double dst_port[HIST_PORT_BINS];
+    double protocol[HIST_PROTO_BINS];
+    double decay;           /* weight of the newest benign window */
+    double threshold;       /* summed KL divergence (nats) that flags */
+    double last_score;
+    int windows;
+} ShiftState;
+
 /* ML-based detection state */
 typedef struct {
     double feature_vector[ML_FEATURES];
@@ -62,8 +174,47 @@ typedef struct {
     int trained;
 } MLDetector;
 
+/* Tree-ensemble node: 16 bytes, four nodes per cache line */
+typedef struct {
+    int   feature;      /* index into the feature vector */
+    float threshold;    /* child[1] is taken when x[feature] > threshold */
+    int   child[2];     /* absolute node offsets; leaves point at themselves */
+} ForestNode;
+
+/* Tree-ensemble detector: all trees share one contiguous node array */
+typedef struct {
+    ForestNode *nodes;
+    float *values;              /* leaf output, indexed like nodes */
+    int roots[FOREST_MAX_TREES];
+    int depths[FOREST_MAX_TREES];
+    int num_trees;
+    int num_nodes;
+    int num_features;
+    double threshold;           /* mean leaf value above this = attack */
+    int loaded;
+} TreeEnsemble;
+
+/* One suspect source with its volume in the reporting window */
+typedef struct {
+    char ip[IP_STR_LEN];
+    long packets;
+    long bytes;
+    int  reports;               /* worker reports that named it */
+} Suspect;
+
+/* MPI message tags between workers and the coordinator */
+#define TAG_ALERT        0      /* one Alert per (worker, window) */
+#define TAG_STREAM_END   1      /* worker has no more windows */
+#define TAG_BATCH        2      /* router -> worker FlowRecord batch */
+#define TAG_CREDIT       3      /* worker -> router, one batch consumed */
+#define TAG_HANDOFF      4      /* router -> worker, ring range moved */
+#define TAG_STATE        5      /* worker -> worker, moved talker state */
+#define TAG_PROVISIONAL  6      /* worker -> coordinator, partial load */
+#define TAG_FINISH       7      /* coordinator -> worker, run collectives? */
+
 typedef struct {
     int    worker_rank;
+    int    window_id;           /* 0 in one-shot mode, sequence in streaming */
     int    attack_flag;         /* 0 = normal, 1 = suspicious */
     char   suspicious_ip[IP_STR_LEN];
     double entropy;
@@ -76,6 +227,10 @@ typedef struct {
     int entropy_detected;
     int cusum_detected;
     int ml_detected;
+    int hw_detected;
+    int shift_detected;
+    double shift_score;     /* KL divergence of port/protocol mix vs baseline */
+    int rate_detected;
     
     /* Performance metrics */
     double processing_time_ms;
@@ -83,8 +238,144 @@ typedef struct {
     
     /* Accuracy metrics */
     int true_label;  /* 1=attack, 0=benign from dataset */
+
+    /* Aggregation: 1 / attack_flag for one worker, sums over a subtree */
+    int attack_votes;
+    int worker_count;
+
+    /* Suspect sources, heaviest first (only the first count go on the wire) */
+    int suspect_count;
+    Suspect suspects[MAX_SUSPECTS];
 } Alert;
 
+/*
+   Collective binary alert log (alertlog.c): header, rank 0's window
+   verdicts, then every rank's own alerts in rank order
+*/
+#define ALERT_LOG_PATH   "results/metrics/alerts.bin"
+#define ALERT_LOG_MAGIC  "DDOSLOG1"
+
+typedef struct {
+    char    magic[8];
+    int32_t alert_size;         /* sizeof(AlertRecord) */
+    int32_t verdict_size;       /* sizeof(VerdictRecord) */
+    int64_t alert_count;
+    int64_t verdict_count;
+    int32_t ranks;
+    int32_t reserved;
+} AlertLogHeader;
+
+typedef struct {
+    int32_t  worker_rank;
+    int32_t  window_id;
+    int32_t  attack_flag;
+    int32_t  detected;          /* DET_MASK() bits that voted attack */
+    int32_t  total_packets;
+    int32_t  total_flows;
+    int32_t  true_label;
+    uint32_t suspicious_ip;     /* binary IPv4, 0 = none */
+    double   entropy;
+    double   avg_rate;
+    double   spike_score;
+    double   shift_score;
+    double   processing_time_ms;
+    int64_t  memory_used_kb;
+} AlertRecord;
+
+typedef struct {
+    int32_t  window_id;
+    int32_t  global_attack;
+    uint32_t chosen_ip;         /* binary IPv4, 0 = none */
+    int32_t  reserved;
+} VerdictRecord;
+
+typedef struct {
+    AlertRecord *alerts;
+    int alert_count;
+    int alert_capacity;
+    VerdictRecord *verdicts;    /* rank 0 only */
+    int verdict_count;
+    int verdict_capacity;
+} AlertLog;
+
+/* Heavy-hitter summary merged across ranks (talkers.c) */
+typedef struct {
+    uint32_t ip;                /* binary IPv4 */
+    int64_t  packets;           /* counted packets (lower bound) */
+    int64_t  bytes;
+    int64_t  error;             /* packets possibly missed; 0 = exact */
+} TalkerEntry;
+
+typedef struct {
+    int64_t total_packets;
+    int64_t total_bytes;
+    int64_t floor;              /* max packets of any unlisted source */
+    int32_t count;
+    TalkerEntry entries[TALKER_SLOTS];      /* packets descending */
+    int64_t buckets[TALKER_BUCKETS];
+} TalkerSummary;
+
+/* Consistent-hash ownership of the IPv4 space (ring.c) */
+typedef struct {
+    uint32_t key;               /* range (previous key, key] */
+    int owner;
+} RingPoint;
+
+typedef struct {
+    RingPoint *points;          /* key ascending */
+    int count;
+    int capacity;
+    int vnodes;                 /* points per owner */
+} HashRing;
+
+/* Sources whose records are spread over several owners (ring.c) */
+typedef struct {
+    uint32_t ip;
+    long count;                 /* space-saving estimate, may overcount */
+} HotCounter;
+
+typedef struct {
+    uint32_t ip;
+    int width;                  /* owners sharing the source */
+    int next;                   /* round-robin position */
+} HotSplit;
+
+typedef struct {
+    HotCounter counters[HOT_KEY_SLOTS];
+    int counter_count;
+    long seen;                  /* records in the current interval */
+    HotSplit split[HOT_KEY_MAX];
+    int split_count;
+    int first_owner;
+    int owners;
+    int max_width;              /* widest split so far */
+    long splits;                /* times a source became hot */
+    long split_records;         /* records spread off their owner's path */
+} HotKeys;
+
+/* One ring range changing hands */
+typedef struct {
+    uint32_t lo, hi;            /* ring keys (lo, hi] */
+    int from, to;               /* worker ranks */
+} RingMove;
+
+/* Incremental vote tally over worker alerts */
+typedef struct {
+    int    reports;
+    int    attack_votes;
+    int    chosen_index;        /* attack alert with the highest avg_rate */
+    double chosen_rate;
+    int    suspect_count;       /* merged top-K of the attack alerts */
+    Suspect suspects[MAX_SUSPECTS];
+} AlertTally;
+
+/* Per-run counters for cascaded detection (how often each stage ran) */
+typedef struct {
+    int windows;
+    int stage_runs[DET_COUNT];
+    int hot_ip_runs;
+} CascadeStats;
+
 /* Performance metrics */
 typedef struct {
     double detection_latency_ms;
@@ -115,15 +406,298 @@ typedef struct {
     double block_time_ms;
 } BlockingStats;
 
+/* Run configuration parsed from the command line */
+typedef struct {
+    const char *dataset_root;
+    const char *forest_model;   /* NULL = logistic-regression ML detector */
+    int cascade;                /* early-exit detection, cheapest first */
+    int hw_season;              /* Holt-Winters season length, in windows */
+    unsigned detector_mask;     /* DET_MASK() bits of enabled detectors */
+    int stream;                 /* long-running per-window service mode */
+    int window_records;         /* records per streaming window */
+    int follow_idle_s;          /* >0: tail partitions, stop after idle */
+    int fanout;                 /* >0: k-ary alert aggregation tree */
+    int chunks;                 /* claim chunk_N.csv files dynamically */
+    int shared;                 /* one dataset load per node, shared window */
+    int coord_worker;           /* rank 0 also analyzes a share of the data */
+    int deadline_ms;            /* >0: decide without reports this late */
+    int reassign;               /* analyze missing partitions on rank 0 */
+    const char *router_input;   /* CIC CSV parsed by the router rank */
+    int mpiio_log;              /* collective binary alert log */
+    int threaded;               /* stream coordinator: comm/decision/action */
+    int provisional;            /* >0: provisional alert every N records */
+    const char *raw_input;      /* CIC CSV read in per-rank byte ranges */
+    int raw_slices;             /* analyzing ranks sharing raw_input */
+} DetectorConfig;
+
+/* Set of blocked IPv4 sources with O(1) membership (blocklist.c) */
+typedef struct {
+    uint32_t slots[BLOCKSET_SLOTS];     /* 0 = empty */
+    int count;
+} BlockSet;
+
+/* Blocklist channel: coordinator broadcasts deltas, workers apply them */
+typedef struct {
+    MPI_Comm comm;                      /* duplicate of MPI_COMM_WORLD */
+    int rank;
+    uint32_t msg[BLOCK_INFLIGHT][1 + BLOCK_DELTA_MAX];
+    MPI_Request req[BLOCK_INFLIGHT];
+    uint32_t pending[MAX_BLOCKED_IPS];  /* coordinator: not yet sent */
+    int pending_count;
+    struct CoordThreads *async;         /* coordinator --threaded: blocks
+                                           go through its threads */
+    int next;                           /* broadcasts started, this side */
+    int persistent;                     /* persistent broadcast slots */
+    int broadcasts;
+    int announced;
+    int ended;                          /* worker: terminator received */
+    BlockSet set;                       /* worker: sources to drop */
+} Blocklist;
+
+/* Incremental reader over one worker's partition file or router stream */
+typedef struct {
+    FILE *fp;
+    char path[512];
+    int rank;
+    int follow_idle_s;
+    int header_skipped;
+    long records_read;
+    const BlockSet *filter;     /* drop records from these sources */
+    long filtered_records;
+    long filtered_packets;
+    int router;                 /* >0: batches from this rank, no file */
+    FlowRecord *batch;
+    int batch_count;
+    int batch_pos;
+    int router_ended;
+    TalkerSummary *state;       /* router: talker state ring moves carry */
+    RingMove moves[RING_MAX_MOVES];     /* handoffs not yet applied */
+    int move_count;
+    int states_expected;        /* moved ranges this worker takes over */
+    int states_received;
+    TalkerSummary *state_out[RING_MAX_MOVES];
+    MPI_Request state_req[RING_MAX_MOVES];
+} FlowSource;
+
+/* This worker's slice of its node's shared dataset (shared.c) */
+typedef struct {
+    MPI_Comm workers;           /* every worker rank */
+    MPI_Comm node;              /* worker ranks sharing this node */
+    MPI_Win win;                /* MPI_Win_allocate_shared region */
+    FlowRecord *records;        /* points into the region, no copy */
+    int count;
+    int node_ranks;
+    long node_records;          /* leader only */
+} SharedDataset;
+
+/* Per-worker state of every detector plus the selected pipeline */
+typedef struct {
+    CusumState cusum;
+    HoltWintersState hw;
+    ShiftState shift;
+    MLDetector ml;
+    TreeEnsemble forest;
+    unsigned mask;
+    int pipeline;               /* PIPELINE_* id or PIPELINE_GENERIC */
+    int cascade;
+} DetectorContext;
+
+/* One rank's chunk-claiming state, kept between claims */
+typedef struct {
+    int rank;
+    const DetectorConfig *cfg;
+    MPI_Win win;                /* chunk counter */
+    DetectorContext detectors;
+    CascadeStats cascade;
+    FlowRecord *records;        /* MAX_FLOWS window buffer */
+    IpStat *stats;
+    int count;                  /* records buffered in the window */
+    int chunks;
+    int windows;
+    long total;
+    double start_time;
+    TalkerSummary *talkers;
+    Alert *alert;
+} ChunkWorker;
+
+/* Everything a detector may look at for one window */
+typedef struct {
+    const Features *feats;
+    const TrafficHistograms *hist;
+    const IpStat *stats;
+    int stat_count;
+    int total_packets;
+} WindowInput;
+
+/*
+   Registry entry; score_ip writes a suspicious IP or leaves it empty.
+   update advances the detector's state without a vote, for windows the
+   cascade decided before reaching it (a no-op for stateless detectors).
+*/
+typedef struct {
+    const char *name;
+    unsigned mask;
+    void (*init)(DetectorContext *ctx, const DetectorConfig *cfg);
+    int  (*score_window)(DetectorContext *ctx, const WindowInput *in);
+    void (*update)(DetectorContext *ctx, const WindowInput *in);
+    int  (*score_ip)(DetectorContext *ctx, const WindowInput *in,
+                     char *out_ip);
+} DetectorOps;
+
 /* Exposed functions used by main.c */
-void worker_start(int rank, int world_size, const char *dataset_root);
-void coordinator_start(int world_size, const char *dataset_root);
+void worker_start(int rank, int world_size, const DetectorConfig *cfg);
+void coordinator_start(int world_size, const DetectorConfig *cfg);
+
+/* Streaming service mode (stream.c) */
+void worker_stream(int rank, int world_size, const DetectorConfig *cfg);
+void coordinator_stream(int world_size, const DetectorConfig *cfg);
+
+/* Shared worker/coordinator building blocks (detector.c) */
+int  flow_source_open(FlowSource *src, int rank, const char *dataset_root,
+                      int follow_idle_s);
+int  flow_source_open_path(FlowSource *src, int rank, const char *path,
+                           int follow_idle_s);
+int  flow_source_read(FlowSource *src, FlowRecord *records, int max_records);
+void flow_source_close(FlowSource *src);
+void sleep_ms(int ms);
+int  analyze_window(DetectorContext *detectors, const FlowRecord *records,
+                    int count, IpStat *stats, int rank, int window_id,
+                    CascadeStats *cascade, Alert *alert);
+void chunk_counter_create(int rank, MPI_Win *win);
+int  chunk_claim(MPI_Win win);
+int  chunk_counter_free(int rank, MPI_Win *win, int analyzed, int *workers);
+int  tree_parent(int rank, int fanout);
+void tree_children(int rank, int fanout, int world_size,
+                   int *first, int *count);
+void tally_init(AlertTally *tally);
+void tally_add(AlertTally *tally, const Alert *alert, int index);
+int  select_suspects(const IpStat *stats, int stat_count,
+                     const char *primary, Suspect *out);
+void suspects_merge(Suspect *acc, int *count, const Suspect *in, int in_count);
+void block_suspicious_ip(const char *ip);
+void blocking_log_flush(void);
+int  already_blocked(char (*blocked)[IP_STR_LEN], int count, const char *ip);
+int  block_ip_once(const char *ip, char (*blocked)[IP_STR_LEN],
+                   int *blocked_count, Blocklist *bl);
+int  block_suspect_set(const AlertTally *tally, char (*blocked)[IP_STR_LEN],
+                       int *blocked_count, Blocklist *bl);
+void append_alert_log(const Alert *alerts, int num_alerts,
+                      int global_attack_flag, const char *chosen_ip);
+
+/* Alert wire format (wire.c); wire_init() after MPI_Init */
+void wire_init(void);
+void wire_free(void);
+int  wire_max_bytes(void);
+int  alert_pack(const Alert *alert, void *buf, int size);
+void alert_unpack(const void *buf, int bytes, Alert *alert);
+void alert_send(const Alert *alert, int dest, int tag);
+void alert_recv(Alert *alert, int source, int tag, MPI_Status *status);
+int  ip_to_u32(const char *ip, uint32_t *out);
+void ip_from_u32(uint32_t ip, char *out);
+
+/* Node-shared dataset (shared.c); both calls are collective */
+int  shared_dataset_load(int rank, const DetectorConfig *cfg,
+                         SharedDataset *ds);
+void shared_dataset_free(SharedDataset *ds);
+
+/* Blocklist broadcast (blocklist.c); open/close are collective */
+int  blockset_contains(const BlockSet *set, uint32_t ip);
+int  blockset_add(BlockSet *set, uint32_t ip);
+void blocklist_open(Blocklist *bl, int rank);
+void blocklist_announce(Blocklist *bl, const char *ip);
+void blocklist_flush(Blocklist *bl, int wait);
+int  blocklist_poll(Blocklist *bl);
+void blocklist_close(Blocklist *bl);
+
+/* Global top talkers (talkers.c); talkers_reduce is collective */
+void talkers_init(TalkerSummary *t);
+void talkers_add_stats(TalkerSummary *t, const IpStat *stats, int stat_count);
+double talkers_entropy(const TalkerSummary *t);
+void talkers_mpi_init(void);
+void talkers_mpi_free(void);
+void talkers_reduce(const TalkerSummary *local, TalkerSummary *global);
+int  talkers_report(const TalkerSummary *global, char (*hot)[IP_STR_LEN],
+                    int max_hot);
+void talkers_split_range(TalkerSummary *t, uint32_t lo, uint32_t hi,
+                         TalkerSummary *moved);
+void talkers_isend(const TalkerSummary *t, int dest, int tag,
+                   MPI_Request *req);
+void talkers_recv_merge(TalkerSummary *t, int source, int tag);
+
+/* Consistent-hash ring (ring.c) */
+uint32_t ring_key(uint32_t ip);
+uint32_t ring_source(const char *ip);
+int  ring_in_range(uint32_t key, uint32_t lo, uint32_t hi);
+int  ring_init(HashRing *ring, int first_owner, int owners, int vnodes);
+int  ring_add_owner(HashRing *ring, int owner);
+void ring_free(HashRing *ring);
+int  ring_point(const HashRing *ring, uint32_t key);
+int  ring_owner(const HashRing *ring, uint32_t key);
+void ring_range(const HashRing *ring, int point, uint32_t *lo, uint32_t *hi);
+void hotkeys_init(HotKeys *hk, int first_owner, int owners);
+int  hotkeys_route(HotKeys *hk, const HashRing *ring, uint32_t ip,
+                   int *point);
+
+/* Collective binary alert log (alertlog.c); alert_log_write is collective */
+void alert_log_init(AlertLog *log);
+void alert_log_add(AlertLog *log, const Alert *alert);
+void alert_log_verdict(AlertLog *log, int window_id, int global_attack,
+                       const char *chosen_ip);
+int  alert_log_write(AlertLog *log, const char *path);
+void alert_log_record(const AlertRecord *rec, Alert *alert);
+void alert_log_free(AlertLog *log);
+void alert_csv_row(FILE *fp, const Alert *a, int global_attack_flag,
+                   const char *chosen_ip);
+
+/* CIC-DDoS2019 CSV rows (cic_format.c) */
+int  cic_parse_record(char *line, FlowRecord *r);
+
+/* Threaded stream coordinator (coordthreads.c) */
+typedef struct CoordThreads CoordThreads;
+CoordThreads *coord_threads_start(Blocklist *bl);
+int  coord_threads_next(CoordThreads *ct, double deadline, Alert *msg,
+                        int *source, int *tag);
+void coord_threads_block(CoordThreads *ct, const char *ip);
+void coord_threads_log(CoordThreads *ct, const Alert *alerts, int count,
+                       int global_attack, const char *chosen_ip);
+void coord_threads_stop(CoordThreads *ct);
+
+/* Raw CIC CSV byte-range slices (rawcsv.c) */
+int  raw_csv_load(const char *path, int slice, int slices, int mpi_io,
+                  FlowRecord *records, int max_records, long *lo, long *hi);
+
+/* Ingest router rank (router.c); world_size - 1 with --router */
+void router_mpi_init(void);
+void router_mpi_free(void);
+void router_run(int rank, int world_size, const DetectorConfig *cfg);
+int  flow_source_open_router(FlowSource *src, int rank, int router,
+                             int follow_idle_s);
+int  router_read(FlowSource *src, FlowRecord *records, int max_records);
+void router_handoff(FlowSource *src, int final);
+
+/* Tree-ensemble inference (forest.c) */
+int  forest_load_model(const char *path, TreeEnsemble *model);
+int  forest_load_stream(FILE *fp, TreeEnsemble *model);
+void forest_free(TreeEnsemble *model);
+void forest_feature_vector(const Features *f, float *out);
+void forest_predict_batch(const TreeEnsemble *model, const float *vectors,
+                          int count, float *scores);
 
 /* Utility functions */
 double get_time_ms(void);
 void init_performance_metrics(PerformanceMetrics *metrics);
 void calculate_accuracy_metrics(PerformanceMetrics *metrics);
 void log_performance_metrics(const PerformanceMetrics *metrics, const char *filename);
-void log_blocking_stats(const BlockingStats *stats, const char *filename);
+void log_blocking_stats(const BlockingStats *stats, int count,
+                        const char *filename);
+void print_cascade_stats(int rank, const CascadeStats *cascade);
+
+/* Detector registry and pipelines (detector.c) */
+const DetectorOps *detector_registry(int *count);
+unsigned detector_mask_from_names(const char *list);
+void detector_context_init(DetectorContext *ctx, const DetectorConfig *cfg);
+void detector_context_free(DetectorContext *ctx);
+int  run_detectors(DetectorContext *ctx, const WindowInput *in,
+                   int *flags, char *out_ip, CascadeStats *stats);
 
 #endif /* DETECTOR_H */
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Tree-ensemble (random forest) inference
+   ============================== */
+/*
+   Model file format (plain text, '#' starts a comment line):
+
+   forest <num_trees> <num_features> <threshold>
+   tree <num_nodes>
+   node <feature> <split> <left> <right>
+   leaf <value>
+   ...
+
+   Each "tree" line is followed by exactly <num_nodes> node/leaf lines.
+   Node 0 of each tree is its root; <left>/<right> are node indices
+   local to the tree.  A vector goes left when x[feature] <= split.
+   Leaf values are averaged over the trees and compared against
+   <threshold> to decide attack / normal.
+
+   Feature indices follow forest_feature_vector():
+   0 entropy        1 avg_rate        2 spike_score     3 unique_ips
+   4 total_packets  5 total_flows     6 packet_size_mean
+   7 packet_size_std 8 syn_ratio      9 udp_ratio
+*/
+
+/* vectors evaluated in lockstep per tree (independent loads overlap) */
+#define FOREST_LANES 8
+
+static int forest_tree_depth(const ForestNode *nodes, int root,
+                             int local, int level)
+{
+    if (level > FOREST_MAX_DEPTH) {
+        return -1;
+    }
+    const ForestNode *n = &nodes[root + local];
+    if (n->child[0] == root + local && n->child[1] == root + local) {
+        return 0;
+    }
+    int l = forest_tree_depth(nodes, root, n->child[0] - root, level + 1);
+    int r = forest_tree_depth(nodes, root, n->child[1] - root, level + 1);
+    if (l < 0 || r < 0) {
+        return -1;
+    }
+    return 1 + (l > r ? l : r);
+}
+
+static int next_model_line(FILE *fp, char *line, int size)
+{
+    while (fgets(line, size, fp)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+        return 1;
+    }
+    return 0;
+}
+
+int forest_load_stream(FILE *fp, TreeEnsemble *model)
+{
+    char line[256];
+    int num_trees = 0, num_features = 0;
+    double threshold = 0.5;
+
+    memset(model, 0, sizeof(TreeEnsemble));
+
+    if (!next_model_line(fp, line, sizeof(line)) ||
+        sscanf(line, "forest %d %d %lf",
+               &num_trees, &num_features, &threshold) != 3) {
+        fprintf(stderr, "Forest: missing 'forest' header\n");
+        return -1;
+    }
+    if (num_trees <= 0 || num_trees > FOREST_MAX_TREES ||
+        num_features <= 0 || num_features > ML_FEATURES) {
+        fprintf(stderr, "Forest: invalid header (%d trees, %d features)\n",
+                num_trees, num_features);
+        return -1;
+    }
+
+    model->nodes  = malloc(sizeof(ForestNode) * FOREST_MAX_NODES);
+    model->values = malloc(sizeof(float) * FOREST_MAX_NODES);
+    if (!model->nodes || !model->values) {
+        fprintf(stderr, "Forest: node allocation failed\n");
+        forest_free(model);
+        return -1;
+    }
+    model->num_features = num_features;
+    model->threshold = threshold;
+
+    int total = 0;
+    for (int t = 0; t < num_trees; t++) {
+        int tree_nodes = 0;
+        if (!next_model_line(fp, line, sizeof(line)) ||
+            sscanf(line, "tree %d", &tree_nodes) != 1 ||
+            tree_nodes <= 0 || total + tree_nodes > FOREST_MAX_NODES) {
+            fprintf(stderr, "Forest: bad 'tree' line for tree %d\n", t);
+            forest_free(model);
+            return -1;
+        }
+
+        int root = total;
+        for (int i = 0; i < tree_nodes; i++) {
+            ForestNode *n = &model->nodes[root + i];
+            int feature = 0, left = 0, right = 0;
+            float split = 0.0f, value = 0.0f;
+
+            if (!next_model_line(fp, line, sizeof(line))) {
+                fprintf(stderr, "Forest: tree %d truncated\n", t);
+                forest_free(model);
+                return -1;
+            }
+            if (sscanf(line, "node %d %f %d %d",
+                       &feature, &split, &left, &right) == 4) {
+                if (feature < 0 || feature >= num_features ||
+                    left <= i || left >= tree_nodes ||
+                    right <= i || right >= tree_nodes) {
+                    fprintf(stderr, "Forest: tree %d node %d out of range\n",
+                            t, i);
+                    forest_free(model);
+                    return -1;
+                }
+                n->feature   = feature;
+                n->threshold = split;
+                n->child[0]  = root + left;
+                n->child[1]  = root + right;
+            } else if (sscanf(line, "leaf %f", &value) == 1) {
+                /* self-loop: extra steps past a leaf stay on the leaf */
+                n->feature   = 0;
+                n->threshold = 0.0f;
+                n->child[0]  = root + i;
+                n->child[1]  = root + i;
+            } else {
+                fprintf(stderr, "Forest: tree %d node %d unparsable\n", t, i);
+                forest_free(model);
+                return -1;
+            }
+            model->values[root + i] = value;
+        }
+
+        int depth = forest_tree_depth(model->nodes, root, 0, 0);
+        if (depth < 0) {
+            fprintf(stderr, "Forest: tree %d deeper than %d\n",
+                    t, FOREST_MAX_DEPTH);
+            forest_free(model);
+            return -1;
+        }
+        model->roots[t]  = root;
+        model->depths[t] = depth;
+        total += tree_nodes;
+    }
+
+    model->num_trees = num_trees;
+    model->num_nodes = total;
+    model->loaded = 1;
+    return 0;
+}
+
+int forest_load_model(const char *path, TreeEnsemble *model)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Forest: could not open %s\n", path);
+        memset(model, 0, sizeof(TreeEnsemble));
+        return -1;
+    }
+    int rc = forest_load_stream(fp, model);
+    fclose(fp);
+    return rc;
+}
+
+void forest_free(TreeEnsemble *model)
+{
+    free(model->nodes);
+    free(model->values);
+    memset(model, 0, sizeof(TreeEnsemble));
+}
+
+void forest_feature_vector(const Features *f, float *out)
+{
+    out[0] = (float)f->entropy;
+    out[1] = (float)f->avg_rate;
+    out[2] = (float)f->spike_score;
+    out[3] = (float)f->unique_ips;
+    out[4] = (float)f->total_packets;
+    out[5] = (float)f->total_flows;
+    out[6] = (float)f->packet_size_mean;
+    out[7] = (float)f->packet_size_std;
+    out[8] = (float)f->syn_ratio;
+    out[9] = (float)f->udp_ratio;
+}
+
+/*
+   Scores `count` vectors laid out with ML_FEATURES floats each.
+   Every tree is walked for exactly depths[t] steps; the child is chosen
+   by indexing with the comparison result, so there is no data-dependent
+   branch in the inner loop.
+*/
+void forest_predict_batch(const TreeEnsemble *model, const float *vectors,
+                          int count, float *scores)
+{
+    for (int i = 0; i < count; i++) {
+        scores[i] = 0.0f;
+    }
+    if (!model->loaded || count <= 0) {
+        return;
+    }
+
+    const ForestNode *nodes = model->nodes;
+
+    for (int t = 0; t < model->num_trees; t++) {
+        int root  = model->roots[t];
+        int depth = model->depths[t];
+
+        for (int base = 0; base < count; base += FOREST_LANES) {
+            int lanes = count - base;
+            if (lanes > FOREST_LANES) lanes = FOREST_LANES;
+
+            int idx[FOREST_LANES];
+            for (int l = 0; l < lanes; l++) {
+                idx[l] = root;
+            }
+            for (int d = 0; d < depth; d++) {
+                for (int l = 0; l < lanes; l++) {
+                    const ForestNode *n = &nodes[idx[l]];
+                    const float *x = vectors + (size_t)(base + l) * ML_FEATURES;
+                    idx[l] = n->child[x[n->feature] > n->threshold];
+                }
+            }
+            for (int l = 0; l < lanes; l++) {
+                scores[base + l] += model->values[idx[l]];
+            }
+        }
+    }
+
+    float inv = 1.0f / (float)model->num_trees;
+    for (int i = 0; i < count; i++) {
+        scores[i] *= inv;
+    }
+}
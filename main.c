@@ -1,11 +1,101 @@
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "detector.h"
 
+static int parse_args(int argc, char **argv, DetectorConfig *cfg)
+{
+    memset(cfg, 0, sizeof(DetectorConfig));
+    if (argc < 2) {
+        return -1;
+    }
+    cfg->dataset_root = argv[1];
+    cfg->hw_season = HW_DEFAULT_SEASON;
+    cfg->detector_mask = DET_DEFAULT_MASK;
+    cfg->window_records = STREAM_WINDOW;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--forest") == 0 && i + 1 < argc) {
+            cfg->forest_model = argv[++i];
+        } else if (strcmp(argv[i], "--cascade") == 0) {
+            cfg->cascade = 1;
+        } else if (strcmp(argv[i], "--hw-season") == 0 && i + 1 < argc) {
+            cfg->hw_season = atoi(argv[++i]);
+            if (cfg->hw_season < 1 || cfg->hw_season > HW_MAX_SEASON) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            cfg->stream = 1;
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            cfg->window_records = atoi(argv[++i]);
+            if (cfg->window_records < 1) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--follow") == 0 && i + 1 < argc) {
+            cfg->stream = 1;
+            cfg->follow_idle_s = atoi(argv[++i]);
+            if (cfg->follow_idle_s < 1) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--router") == 0 && i + 1 < argc) {
+            cfg->stream = 1;
+            cfg->router_input = argv[++i];
+        } else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc) {
+            cfg->raw_input = argv[++i];
+        } else if (strcmp(argv[i], "--fanout") == 0 && i + 1 < argc) {
+            cfg->fanout = atoi(argv[++i]);
+            if (cfg->fanout < 2) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--chunks") == 0) {
+            cfg->chunks = 1;
+        } else if (strcmp(argv[i], "--shared") == 0) {
+            cfg->shared = 1;
+        } else if (strcmp(argv[i], "--coord-worker") == 0) {
+            cfg->coord_worker = 1;
+        } else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) {
+            cfg->deadline_ms = atoi(argv[++i]);
+            if (cfg->deadline_ms < 1) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--reassign") == 0) {
+            cfg->reassign = 1;
+        } else if (strcmp(argv[i], "--provisional") == 0 && i + 1 < argc) {
+            cfg->provisional = atoi(argv[++i]);
+            if (cfg->provisional < 1) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--threaded") == 0) {
+            cfg->threaded = 1;
+        } else if (strcmp(argv[i], "--mpiio") == 0) {
+            cfg->mpiio_log = 1;
+        } else if (strcmp(argv[i], "--detectors") == 0 && i + 1 < argc) {
+            cfg->detector_mask = detector_mask_from_names(argv[++i]);
+            if (cfg->detector_mask == 0) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
-    MPI_Init(&argc, &argv);
+    /*
+       --coord-worker runs detection on a helper thread without MPI;
+       --threaded moves the stream coordinator's MPI to a comm thread
+    */
+    int required = MPI_THREAD_FUNNELED;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--threaded") == 0) {
+            required = MPI_THREAD_MULTIPLE;
+        }
+    }
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, required, &provided);
 
     int rank = 0;
     int size = 0;
@@ -13,16 +103,68 @@ int main(int argc, char **argv)
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    if (argc < 2) {
+    DetectorConfig cfg;
+    if (parse_args(argc, argv, &cfg) != 0) {
         if (rank == 0) {
-            printf("Usage: mpirun -np <N> ./ddos_detector <data_root>\n");
+            printf("Usage: mpirun -np <N> ./ddos_detector <data_root> "
+                   "[options]\n");
+            printf("Options:\n");
+            printf("  --forest <model>   use tree-ensemble ML detector\n");
+            printf("  --cascade          early-exit detection, cheapest "
+                   "detector first\n");
+            printf("  --hw-season <n>    Holt-Winters season length in "
+                   "windows (default %d)\n", HW_DEFAULT_SEASON);
+            printf("  --detectors <list> comma-separated subset of "
+                   "entropy,rate,cusum,hw,shift,ml\n");
+            printf("  --stream           per-window service mode\n");
+            printf("  --window <n>       records per streaming window "
+                   "(default %d)\n", STREAM_WINDOW);
+            printf("  --follow <sec>     stream and tail partitions until "
+                   "idle for <sec>\n");
+            printf("  --router <csv>     stream a raw CIC CSV through a "
+                   "router rank (last rank)\n");
+            printf("  --raw <csv>        read byte ranges of a raw CIC CSV "
+                   "with MPI-IO (one-shot)\n");
+            printf("  --fanout <k>       merge alerts up a k-ary tree "
+                   "(one-shot mode, k >= 2)\n");
+            printf("  --chunks           claim chunk_N.csv files "
+                   "dynamically (one-shot mode)\n");
+            printf("  --shared           one partition load per node "
+                   "into shared memory\n");
+            printf("  --coord-worker     coordinator also analyzes "
+                   "part_<N>.csv or claims chunks\n");
+            printf("  --deadline <ms>    decide without reports later "
+                   "than <ms> (per window in streams)\n");
+            printf("  --reassign         with --deadline, analyze missing "
+                   "partitions on rank 0\n");
+            printf("  --provisional <n>  provisional alert every <n> "
+                   "records while loading (one-shot)\n");
+            printf("  --threaded         stream coordinator with comm, "
+                   "decision and action threads\n");
+            printf("  --mpiio            write alerts to %s with "
+                   "collective MPI-IO\n", ALERT_LOG_PATH);
             printf("Example: mpirun -np 4 ./ddos_detector data\n");
         }
         MPI_Finalize();
         return 0;
     }
 
-    const char *dataset_root = argv[1];
+    /* fewer detectors than the vote threshold could never flag a window */
+    int enabled = 0;
+    for (int d = 0; d < DET_COUNT; d++) {
+        if (cfg.detector_mask & (1u << d)) {
+            enabled++;
+        }
+    }
+    if (enabled < VOTE_THRESHOLD) {
+        if (rank == 0) {
+            fprintf(stderr, "--detectors needs at least %d detectors: a "
+                            "window is flagged when %d of them vote "
+                            "attack\n", VOTE_THRESHOLD, VOTE_THRESHOLD);
+        }
+        MPI_Finalize();
+        return 0;
+    }
 
     if (size < 2) {
         if (rank == 0) {
@@ -33,12 +175,89 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (cfg.router_input && size < 3) {
+        if (rank == 0) {
+            fprintf(stderr, "--router needs at least 3 MPI processes "
+                            "(coordinator, worker, router)\n");
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (cfg.stream &&
+        (cfg.fanout > 0 || cfg.chunks || cfg.shared || cfg.coord_worker)) {
+        if (rank == 0) {
+            printf("Note: --fanout, --chunks, --shared and --coord-worker "
+                   "apply to one-shot mode only; ignored with --stream\n");
+        }
+        cfg.fanout = 0;
+        cfg.chunks = 0;
+        cfg.shared = 0;
+        cfg.coord_worker = 0;
+    }
+    if (cfg.reassign &&
+        (cfg.deadline_ms == 0 || cfg.stream || cfg.fanout > 0 || cfg.chunks)) {
+        if (rank == 0) {
+            printf("Note: --reassign needs --deadline and static one-shot "
+                   "partitions without --fanout; ignored\n");
+        }
+        cfg.reassign = 0;
+    }
+    if (cfg.threaded && (!cfg.stream || provided < MPI_THREAD_SERIALIZED)) {
+        if (rank == 0) {
+            printf("Note: --threaded needs --stream and an MPI library "
+                   "with thread support; ignored\n");
+        }
+        cfg.threaded = 0;
+    }
+    if (cfg.provisional > 0 &&
+        (cfg.stream || cfg.chunks || cfg.shared || cfg.raw_input)) {
+        if (rank == 0) {
+            printf("Note: --provisional applies to one-shot loads of "
+                   "part_<N>.csv only; ignored\n");
+        }
+        cfg.provisional = 0;
+    }
+    if (cfg.provisional > 0 && cfg.deadline_ms > 0) {
+        /* a straggler's unmatched provisional send would outlive rank 0 */
+        if (rank == 0) {
+            printf("Note: --provisional does not combine with --deadline; "
+                   "ignored\n");
+        }
+        cfg.provisional = 0;
+    }
+    if (cfg.raw_input && (cfg.stream || cfg.chunks || cfg.shared)) {
+        if (rank == 0) {
+            printf("Note: --raw applies to one-shot static partitions "
+                   "only; ignored (use --router to stream a raw CSV)\n");
+        }
+        cfg.raw_input = NULL;
+    }
+    if (cfg.raw_input) {
+        cfg.raw_slices = size - 1 + (cfg.coord_worker ? 1 : 0);
+    }
+    if (cfg.chunks && cfg.shared) {
+        if (rank == 0) {
+            printf("Note: --shared does not apply to --chunks; ignored\n");
+        }
+        cfg.shared = 0;
+    }
+
+    wire_init();
+    talkers_mpi_init();
+    router_mpi_init();
+
     if (rank == 0) {
-        coordinator_start(size, dataset_root);
+        coordinator_start(size, &cfg);
+    } else if (cfg.router_input && rank == size - 1) {
+        router_run(rank, size, &cfg);
     } else {
-        worker_start(rank, size, dataset_root);
+        worker_start(rank, size, &cfg);
     }
 
+    router_mpi_free();
+    talkers_mpi_free();
+    wire_free();
     MPI_Finalize();
     return 0;
 }
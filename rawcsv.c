@@ -0,0 +1,185 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Direct raw CIC CSV slices
+   ============================== */
+/*
+   With --raw, each analyzing rank reads its own byte range of the
+   original CIC-DDoS2019 CSV.  There is no csv_parser pass and no
+   partition files.  Slice i of n covers bytes [size*i/n, size*(i+1)/n)
+   and owns every line that starts in it:
+
+   - a slice after the first skips the partial line at its start, which
+     the previous slice completes (reading begins one byte early, so a
+     line starting exactly on the boundary is kept);
+   - a slice reads past its end only to finish its last line;
+   - slice 0 drops the header.
+
+   Ranks read with MPI_File_read_at on MPI_COMM_SELF, RAW_READ_BLOCK
+   bytes at a time, so no rank waits on another.  The coordinator's
+   helper thread may not call MPI (MPI_THREAD_FUNNELED); it passes
+   mpi_io = 0 and reads the same bytes with stdio.
+*/
+
+typedef struct {
+    MPI_File fh;
+    FILE *fp;
+    long size;
+} RawFile;
+
+static int raw_open(RawFile *f, const char *path, int mpi_io)
+{
+    memset(f, 0, sizeof(RawFile));
+    if (mpi_io) {
+        MPI_Offset size = 0;
+        if (MPI_File_open(MPI_COMM_SELF, (char *)path, MPI_MODE_RDONLY,
+                          MPI_INFO_NULL, &f->fh) != MPI_SUCCESS) {
+            return -1;
+        }
+        MPI_File_get_size(f->fh, &size);
+        f->size = (long)size;
+        return 0;
+    }
+    f->fp = fopen(path, "rb");
+    if (!f->fp || fseek(f->fp, 0, SEEK_END) != 0) {
+        if (f->fp) fclose(f->fp);
+        return -1;
+    }
+    f->size = ftell(f->fp);
+    return 0;
+}
+
+/* bytes read at `offset`; 0 at end of file */
+static long raw_read_at(RawFile *f, long offset, char *buf, int bytes)
+{
+    if (f->fp) {
+        if (fseek(f->fp, offset, SEEK_SET) != 0) {
+            return 0;
+        }
+        return (long)fread(buf, 1, bytes, f->fp);
+    }
+    MPI_Status status;
+    int got = 0;
+    if (MPI_File_read_at(f->fh, (MPI_Offset)offset, buf, bytes, MPI_BYTE,
+                         &status) != MPI_SUCCESS) {
+        return 0;
+    }
+    MPI_Get_count(&status, MPI_BYTE, &got);
+    return got;
+}
+
+static void raw_close(RawFile *f)
+{
+    if (f->fp) {
+        fclose(f->fp);
+    } else {
+        MPI_File_close(&f->fh);
+    }
+}
+
+/* parses one complete line (newline already removed) into records */
+static void raw_add_line(char *line, long len, FlowRecord *records,
+                         int *count)
+{
+    if (len > 0 && line[len - 1] == '\r') {
+        line[--len] = '\0';
+    }
+    if (len == 0 || len >= CIC_MAX_LINE) {
+        return;
+    }
+    FlowRecord r;
+    if (cic_parse_record(line, &r) != 0) {
+        return;
+    }
+    if (r.packets <= 0) {
+        r.packets = 1;
+    }
+    records[(*count)++] = r;
+}
+
+/*
+   Loads slice `slice` of `slices` of the raw CSV at `path`.  Returns
+   the record count (at most max_records), or -1 if the file cannot be
+   opened.  *lo and *hi receive the slice's byte range.
+*/
+int raw_csv_load(const char *path, int slice, int slices, int mpi_io,
+                 FlowRecord *records, int max_records, long *lo, long *hi)
+{
+    RawFile f;
+    if (raw_open(&f, path, mpi_io) != 0) {
+        return -1;
+    }
+    *lo = (long)((double)f.size * slice / slices);
+    *hi = (long)((double)f.size * (slice + 1) / slices);
+
+    char *buf = malloc(RAW_READ_BLOCK + 1);
+    if (!buf) {
+        raw_close(&f);
+        return -1;
+    }
+
+    int count = 0;
+    int syncing = slice > 0;        /* skipping the previous slice's line */
+    int header = slice == 0;
+    long buf_at = syncing ? *lo - 1 : *lo;  /* file offset of buf[0] */
+    int have = 0;
+    int done = 0;
+
+    while (!done && count < max_records) {
+        long got = raw_read_at(&f, buf_at + have, buf + have,
+                               RAW_READ_BLOCK - have);
+        int end = have + (int)got;
+        int p = 0;
+        while (count < max_records) {
+            char *nl = memchr(buf + p, '\n', end - p);
+            if (!nl) {
+                break;
+            }
+            long line_at = buf_at + p;
+            int len = (int)(nl - (buf + p));
+            *nl = '\0';
+            if (syncing) {
+                syncing = 0;
+            } else if (line_at >= *hi) {
+                done = 1;
+                break;
+            } else if (header) {
+                header = 0;
+            } else {
+                raw_add_line(buf + p, len, records, &count);
+            }
+            p += len + 1;
+        }
+        if (done) {
+            break;
+        }
+
+        if (got == 0) {
+            /* last line of the file without a newline */
+            if (!syncing && p < end && buf_at + p < *hi && !header) {
+                buf[end] = '\0';
+                raw_add_line(buf + p, end - p, records, &count);
+            }
+            break;
+        }
+        if (p == 0 && end == RAW_READ_BLOCK) {
+            /* no newline in a whole block: drop it and resync */
+            buf_at += end;
+            have = 0;
+            syncing = 1;
+            continue;
+        }
+        /* keep the partial line at the front for the next read */
+        memmove(buf, buf + p, end - p);
+        buf_at += p;
+        have = end - p;
+    }
+
+    free(buf);
+    raw_close(&f);
+    return count;
+}
@@ -0,0 +1,275 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Consistent-hash IP ownership
+   ============================== */
+/*
+   Each owner (a worker rank or partition number) places `vnodes` points
+   on a 32-bit ring; a point owns the keys from the previous point up to
+   and including its own.  A source IP's key is its hashed address, so
+   all records of one source land on one owner and its local statistics
+   see the source's full volume.
+
+   Adding an owner only takes over the ranges ending at its new points,
+   and moving one point hands over one range; every other key keeps its
+   owner.  Rebalancing therefore moves only the state of those ranges.
+*/
+
+/* murmur3 finalizer: spreads neighbouring addresses over the ring */
+static uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t ring_key(uint32_t ip)
+{
+    return mix32(ip);
+}
+
+/*
+   What a source is placed by: its IPv4 address, or an FNV-1a hash of
+   any other address string, so IPv6 sources spread like IPv4 ones
+   instead of all landing on key 0.
+*/
+uint32_t ring_source(const char *ip)
+{
+    uint32_t addr;
+    if (ip_to_u32(ip, &addr) == 0) {
+        return addr;
+    }
+    uint32_t h = 2166136261u;
+    for (const char *p = ip; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* key in (lo, hi], wrapping past 0 when lo >= hi */
+int ring_in_range(uint32_t key, uint32_t lo, uint32_t hi)
+{
+    if (lo < hi) {
+        return key > lo && key <= hi;
+    }
+    return key > lo || key <= hi;
+}
+
+static int by_ring_key(const void *a, const void *b)
+{
+    const RingPoint *x = a;
+    const RingPoint *y = b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->owner - y->owner;
+}
+
+/* owners first_owner .. first_owner + owners - 1; -1 on allocation failure */
+int ring_init(HashRing *ring, int first_owner, int owners, int vnodes)
+{
+    memset(ring, 0, sizeof(HashRing));
+    ring->vnodes = vnodes;
+    for (int o = 0; o < owners; o++) {
+        if (ring_add_owner(ring, first_owner + o) != 0) {
+            ring_free(ring);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int ring_add_owner(HashRing *ring, int owner)
+{
+    if (ring->count + ring->vnodes > ring->capacity) {
+        int capacity = ring->capacity ? ring->capacity * 2 : 8 * ring->vnodes;
+        while (capacity < ring->count + ring->vnodes) {
+            capacity *= 2;
+        }
+        RingPoint *points = realloc(ring->points, sizeof(RingPoint) * capacity);
+        if (!points) {
+            return -1;
+        }
+        ring->points = points;
+        ring->capacity = capacity;
+    }
+
+    for (int v = 0; v < ring->vnodes; v++) {
+        RingPoint *p = &ring->points[ring->count++];
+        p->key = mix32((uint32_t)owner * 0x9e3779b9u ^ mix32((uint32_t)v + 1));
+        p->owner = owner;
+    }
+    qsort(ring->points, ring->count, sizeof(RingPoint), by_ring_key);
+    return 0;
+}
+
+void ring_free(HashRing *ring)
+{
+    free(ring->points);
+    memset(ring, 0, sizeof(HashRing));
+}
+
+/* index of the point owning `key`: the first at or after it, wrapping */
+int ring_point(const HashRing *ring, uint32_t key)
+{
+    int lo = 0, hi = ring->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ring->points[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == ring->count ? 0 : lo;
+}
+
+int ring_owner(const HashRing *ring, uint32_t key)
+{
+    return ring->points[ring_point(ring, key)].owner;
+}
+
+/* keys owned by `point`: (lo, hi] */
+void ring_range(const HashRing *ring, int point, uint32_t *lo, uint32_t *hi)
+{
+    int prev = point > 0 ? point - 1 : ring->count - 1;
+    *lo = ring->points[prev].key;
+    *hi = ring->points[point].key;
+}
+
+/* ==============================
+   Hot-key splitting
+   ============================== */
+/*
+   One source can carry most of a flood.  Whichever owner holds it gets
+   that share however the ring is balanced, so a hot source is spread
+   round-robin over `width` consecutive owners, starting at its ring
+   owner.  Each of them counts part of the source's traffic; the parts
+   add up again where the coordinator merges alert suspects and talker
+   summaries.
+
+   Hot sources come from a space-saving sketch of HOT_KEY_SLOTS
+   counters, re-evaluated every HOT_KEY_CHECK records.  A source is hot
+   once it alone fills HOT_KEY_LOAD of an owner's fair share, and is
+   split so that each part stays near that level.  A split source is
+   merged back once it falls below half the threshold.  The threshold is
+   a whole fair share: splitting costs the exact per-source statistics
+   the ring gives, and a lighter source is better served by moving its
+   range (rebalance in router.c).
+*/
+
+void hotkeys_init(HotKeys *hk, int first_owner, int owners)
+{
+    memset(hk, 0, sizeof(HotKeys));
+    hk->first_owner = first_owner;
+    hk->owners = owners;
+}
+
+static void hotkeys_count(HotKeys *hk, uint32_t ip)
+{
+    int min = 0;
+    for (int i = 0; i < hk->counter_count; i++) {
+        if (hk->counters[i].ip == ip) {
+            hk->counters[i].count++;
+            return;
+        }
+        if (hk->counters[i].count < hk->counters[min].count) {
+            min = i;
+        }
+    }
+    if (hk->counter_count < HOT_KEY_SLOTS) {
+        hk->counters[hk->counter_count].ip = ip;
+        hk->counters[hk->counter_count].count = 1;
+        hk->counter_count++;
+        return;
+    }
+    /* the newcomer inherits the smallest count */
+    hk->counters[min].ip = ip;
+    hk->counters[min].count++;
+}
+
+static int by_count_desc(const void *a, const void *b)
+{
+    const HotCounter *x = a;
+    const HotCounter *y = b;
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return x->ip < y->ip ? -1 : (x->ip > y->ip);
+}
+
+/* picks the split set for the next interval and starts a new one */
+static void hotkeys_update(HotKeys *hk)
+{
+    HotSplit next[HOT_KEY_MAX];
+    int n = 0;
+    double level = HOT_KEY_LOAD * (double)hk->seen / hk->owners;
+
+    qsort(hk->counters, hk->counter_count, sizeof(HotCounter), by_count_desc);
+    for (int i = 0; i < hk->counter_count && n < HOT_KEY_MAX; i++) {
+        const HotCounter *c = &hk->counters[i];
+        int was = -1;
+        for (int j = 0; j < hk->split_count; j++) {
+            if (hk->split[j].ip == c->ip) was = j;
+        }
+        if (c->count < (was >= 0 ? 0.5 * level : level)) {
+            break;              /* sorted: nothing further is hot */
+        }
+
+        int width = (int)ceil(c->count / level);
+        if (width < 2) width = 2;
+        if (width > hk->owners) width = hk->owners;
+
+        next[n].ip = c->ip;
+        next[n].width = width;
+        next[n].next = was >= 0 ? hk->split[was].next % width : 0;
+        if (was < 0) {
+            hk->splits++;
+        }
+        if (width > hk->max_width) {
+            hk->max_width = width;
+        }
+        n++;
+    }
+
+    memcpy(hk->split, next, sizeof(HotSplit) * n);
+    hk->split_count = n;
+    hk->counter_count = 0;
+    hk->seen = 0;
+}
+
+/*
+   Owner of one record from `ip`.  *point is the ring point charged
+   with it, or -1 when the record was spread as part of a hot source.
+*/
+int hotkeys_route(HotKeys *hk, const HashRing *ring, uint32_t ip, int *point)
+{
+    hotkeys_count(hk, ip);
+    if (++hk->seen == HOT_KEY_CHECK && hk->owners > 1) {
+        hotkeys_update(hk);
+    }
+
+    *point = ring_point(ring, ring_key(ip));
+    int owner = ring->points[*point].owner;
+    for (int i = 0; i < hk->split_count; i++) {
+        HotSplit *h = &hk->split[i];
+        if (h->ip != ip) {
+            continue;
+        }
+        int step = h->next;
+        h->next = (h->next + 1) % h->width;
+        hk->split_records++;
+        *point = -1;
+        return hk->first_owner +
+               (owner - hk->first_owner + step) % hk->owners;
+    }
+    return owner;
+}
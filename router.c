@@ -0,0 +1,563 @@
+#include <mpi.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Ingest router
+   ============================== */
+/*
+   With --router <file>, the highest rank parses a CIC-DDoS2019 CSV
+   (tailing it with --follow) and streams binary FlowRecord batches to
+   the workers, so no pre-written part_N.csv files are needed.  Each
+   record goes to the worker that owns its source IP on a consistent-hash
+   ring (ring.c), so a worker's per-IP statistics see the full volume of
+   the sources it owns.
+
+   Flow control is credit based.  Every worker starts with
+   ROUTER_CREDITS credits and returns one per batch it has consumed.
+   The router keeps one send buffer per credit and stops reading input
+   while a worker with a full batch has no credit left, so router memory
+   is bounded by workers x credits x ROUTER_BATCH records.  An empty
+   batch ends a worker's stream.
+
+   Every REBALANCE_RECORDS records the router compares worker loads.  If
+   the busiest worker carries REBALANCE_OVERLOAD x the mean, the ring
+   point whose move best evens it out is handed to the least loaded
+   worker, provided the move clears the overload or cuts the peak by
+   REBALANCE_GAIN.  A marginal move would only bounce the range and its
+   talker state between workers.  Both workers get a TAG_HANDOFF in
+   their batch stream; the old owner then sends the talker state of that
+   range to the new one (router_handoff), and no other range moves.
+
+   A source that alone fills HOT_KEY_LOAD of a worker's share is spread
+   over several workers instead (hotkeys_route).  Its records are not
+   charged to any ring point, so rebalancing only moves the rest.
+
+   The router also follows the blocklist broadcast and drops records
+   from blocked sources before routing them.
+*/
+
+#define REBALANCE_RECORDS  (64 * ROUTER_BATCH)
+#define REBALANCE_OVERLOAD 1.25
+#define REBALANCE_GAIN     0.10     /* minimum peak reduction of a move */
+
+typedef struct {
+    FlowRecord *buf[ROUTER_CREDITS];
+    MPI_Request req[ROUTER_CREDITS];
+    int slot;                   /* buffer being filled */
+    int count;                  /* records in it */
+    int credits;
+    long batches;
+    long records;
+} RouterLane;
+
+static MPI_Datatype record_type = MPI_DATATYPE_NULL;
+
+void router_mpi_init(void)
+{
+    if (record_type != MPI_DATATYPE_NULL) {
+        return;
+    }
+
+    MPI_Datatype tmp;
+    int lengths[3] = { IP_STR_LEN, IP_STR_LEN, 6 };
+    MPI_Aint disps[3] = {
+        offsetof(FlowRecord, src_ip),
+        offsetof(FlowRecord, dst_ip),
+        offsetof(FlowRecord, bytes)
+    };
+    MPI_Datatype types[3] = { MPI_CHAR, MPI_CHAR, MPI_INT };
+    MPI_Type_create_struct(3, lengths, disps, types, &tmp);
+    MPI_Type_create_resized(tmp, 0, sizeof(FlowRecord), &record_type);
+    MPI_Type_free(&tmp);
+    MPI_Type_commit(&record_type);
+}
+
+void router_mpi_free(void)
+{
+    if (record_type != MPI_DATATYPE_NULL) {
+        MPI_Type_free(&record_type);
+    }
+}
+
+/* takes one credit message, blocking if none has arrived */
+static void take_credit(RouterLane *lanes, int block)
+{
+    int flag = 1;
+    MPI_Status status;
+    if (block) {
+        MPI_Probe(MPI_ANY_SOURCE, TAG_CREDIT, MPI_COMM_WORLD, &status);
+    } else {
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_CREDIT, MPI_COMM_WORLD, &flag,
+                   &status);
+    }
+    while (flag) {
+        int grant = 0;
+        MPI_Recv(&grant, 1, MPI_INT, status.MPI_SOURCE, TAG_CREDIT,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        lanes[status.MPI_SOURCE - 1].credits += grant;
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_CREDIT, MPI_COMM_WORLD, &flag,
+                   &status);
+    }
+}
+
+static void lane_send(RouterLane *lane, int worker)
+{
+    if (lane->count == 0) {
+        return;
+    }
+    MPI_Isend(lane->buf[lane->slot], lane->count, record_type, worker,
+              TAG_BATCH, MPI_COMM_WORLD, &lane->req[lane->slot]);
+    lane->credits--;
+    lane->batches++;
+    lane->records += lane->count;
+    lane->slot = (lane->slot + 1) % ROUTER_CREDITS;
+    lane->count = 0;
+}
+
+/*
+   Hands the busiest worker's heaviest useful ring point to the least
+   loaded worker when the busiest carries REBALANCE_OVERLOAD x the mean
+   and the move brings the peak under that or lowers it by
+   REBALANCE_GAIN.  `load` counts records per ring point since the last
+   check.  Returns 1 if a range moved.
+*/
+static int rebalance(HashRing *ring, long *load, RouterLane *lanes,
+                     int num_workers, int rank)
+{
+    long *worker_load = calloc(num_workers, sizeof(long));
+    if (!worker_load) {
+        return 0;
+    }
+    long total = 0;
+    for (int i = 0; i < ring->count; i++) {
+        worker_load[ring->points[i].owner - 1] += load[i];
+        total += load[i];
+    }
+    int busiest = 0, idlest = 0;
+    for (int w = 1; w < num_workers; w++) {
+        if (worker_load[w] > worker_load[busiest]) busiest = w;
+        if (worker_load[w] < worker_load[idlest]) idlest = w;
+    }
+
+    /* the move that lowers the larger of the two loads the most */
+    int best = -1;
+    long best_peak = worker_load[busiest];
+    double mean = (double)total / num_workers;
+    /* worth a move: clears the overload or cuts the peak by the gain */
+    double worth = REBALANCE_OVERLOAD * mean;
+    if (worth < (1.0 - REBALANCE_GAIN) * worker_load[busiest]) {
+        worth = (1.0 - REBALANCE_GAIN) * worker_load[busiest];
+    }
+    if (busiest != idlest && worker_load[busiest] > REBALANCE_OVERLOAD * mean) {
+        for (int i = 0; i < ring->count; i++) {
+            if (ring->points[i].owner != busiest + 1 || load[i] == 0) {
+                continue;
+            }
+            long from = worker_load[busiest] - load[i];
+            long to = worker_load[idlest] + load[i];
+            long peak = from > to ? from : to;
+            if (peak < best_peak && peak <= worth) {
+                best_peak = peak;
+                best = i;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        RingMove move;
+        ring_range(ring, best, &move.lo, &move.hi);
+        move.from = busiest + 1;
+        move.to = idlest + 1;
+
+        /* records already routed to the old owner precede the handoff */
+        lane_send(&lanes[busiest], move.from);
+        uint32_t msg[4] = {
+            move.lo, move.hi, (uint32_t)move.from, (uint32_t)move.to
+        };
+        MPI_Send(msg, 4, MPI_UINT32_T, move.from, TAG_HANDOFF,
+                 MPI_COMM_WORLD);
+        MPI_Send(msg, 4, MPI_UINT32_T, move.to, TAG_HANDOFF, MPI_COMM_WORLD);
+        ring->points[best].owner = move.to;
+
+        printf("Router %d: moved ring range (%08x, %08x] from worker %d "
+               "to %d (%ld of its %ld records)\n", rank, move.lo, move.hi,
+               move.from, move.to, load[best], worker_load[busiest]);
+    }
+
+    memset(load, 0, sizeof(long) * ring->count);
+    free(worker_load);
+    return best >= 0;
+}
+
+static void lane_push(RouterLane *lanes, int worker, const FlowRecord *r,
+                      long *stalls)
+{
+    RouterLane *lane = &lanes[worker - 1];
+    if (lane->count == 0) {
+        /* a credit means the worker is done with this buffer's batch */
+        take_credit(lanes, 0);
+        if (lane->credits == 0) {
+            (*stalls)++;
+            while (lane->credits == 0) {
+                take_credit(lanes, 1);
+            }
+        }
+        MPI_Wait(&lane->req[lane->slot], MPI_STATUS_IGNORE);
+    }
+    lane->buf[lane->slot][lane->count++] = *r;
+    if (lane->count == ROUTER_BATCH) {
+        lane_send(lane, worker);
+    }
+}
+
+void router_run(int rank, int world_size, const DetectorConfig *cfg)
+{
+    int num_workers = world_size - 2;
+    long residual[2] = { 0, 0 };    /* records, packets dropped here */
+    long parsed = 0, stalls = 0, routed_since = 0;
+    int moves = 0;
+
+    HashRing ring;
+    HotKeys hot;
+    Blocklist *bl = malloc(sizeof(Blocklist));
+    RouterLane *lanes = calloc(num_workers, sizeof(RouterLane));
+    char *line = malloc(CIC_MAX_LINE);
+    long *load = NULL;
+    if (ring_init(&ring, 1, num_workers, RING_VNODES) == 0) {
+        load = calloc(ring.count, sizeof(long));
+    }
+    hotkeys_init(&hot, 1, num_workers);
+    if (!bl || !lanes || !line || !load) {
+        fprintf(stderr, "Router %d: allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int w = 0; w < num_workers; w++) {
+        lanes[w].credits = ROUTER_CREDITS;
+        for (int s = 0; s < ROUTER_CREDITS; s++) {
+            lanes[w].buf[s] = malloc(sizeof(FlowRecord) * ROUTER_BATCH);
+            lanes[w].req[s] = MPI_REQUEST_NULL;
+            if (!lanes[w].buf[s]) {
+                fprintf(stderr, "Router %d: batch allocation failed\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+    blocklist_open(bl, rank);
+
+    FILE *fp = fopen(cfg->router_input, "r");
+    if (!fp) {
+        fprintf(stderr, "Router %d: could not open %s\n", rank,
+                cfg->router_input);
+    }
+
+    int header_skipped = 0;
+    double start_time = get_time_ms();
+    double idle_since = start_time;
+    while (fp) {
+        long line_start = ftell(fp);
+
+        if (!fgets(line, CIC_MAX_LINE, fp)) {
+            clearerr(fp);
+            if (cfg->follow_idle_s <= 0) {
+                break;
+            }
+            /* idle input: hand over partial batches, then wait */
+            for (int w = 0; w < num_workers; w++) {
+                lane_send(&lanes[w], w + 1);
+            }
+            if (get_time_ms() - idle_since > cfg->follow_idle_s * 1000.0) {
+                break;
+            }
+            blocklist_poll(bl);
+            sleep_ms(FOLLOW_POLL_MS);
+            continue;
+        }
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        } else if (cfg->follow_idle_s > 0 && len < CIC_MAX_LINE - 1) {
+            /* writer is mid-line: retry from the line start later */
+            fseek(fp, line_start, SEEK_SET);
+            sleep_ms(FOLLOW_POLL_MS);
+            continue;
+        }
+        idle_since = get_time_ms();
+
+        if (!header_skipped) {
+            header_skipped = 1;
+            continue;
+        }
+
+        FlowRecord r;
+        if (cic_parse_record(line, &r) != 0) {
+            continue;
+        }
+        if (r.packets <= 0) {
+            r.packets = 1;
+        }
+        if ((++parsed % ROUTER_BATCH) == 0) {
+            blocklist_poll(bl);
+        }
+        /* the blocklist holds IPv4 only; others route by a string hash */
+        uint32_t addr;
+        if (ip_to_u32(r.src_ip, &addr) == 0 &&
+            blockset_contains(&bl->set, addr)) {
+            residual[0]++;
+            residual[1] += r.packets;
+            continue;
+        }
+
+        int point;
+        int worker = hotkeys_route(&hot, &ring, ring_source(r.src_ip),
+                                   &point);
+        if (point >= 0) {
+            load[point]++;
+        }
+        lane_push(lanes, worker, &r, &stalls);
+        if (++routed_since % REBALANCE_RECORDS == 0) {
+            moves += rebalance(&ring, load, lanes, num_workers, rank);
+        }
+    }
+    if (fp) {
+        fclose(fp);
+    }
+
+    /* last partial batches, then an empty batch ends each stream */
+    for (int w = 0; w < num_workers; w++) {
+        lane_send(&lanes[w], w + 1);
+        MPI_Send(NULL, 0, record_type, w + 1, TAG_BATCH, MPI_COMM_WORLD);
+    }
+    /* every batch is consumed before its end marker: collect all credits */
+    for (int w = 0; w < num_workers; w++) {
+        while (lanes[w].credits < ROUTER_CREDITS) {
+            take_credit(lanes, 1);
+        }
+        MPI_Waitall(ROUTER_CREDITS, lanes[w].req, MPI_STATUSES_IGNORE);
+    }
+
+    long min_records = -1, max_records = 0, routed = 0, batches = 0;
+    for (int w = 0; w < num_workers; w++) {
+        routed += lanes[w].records;
+        batches += lanes[w].batches;
+        if (min_records < 0 || lanes[w].records < min_records) {
+            min_records = lanes[w].records;
+        }
+        if (lanes[w].records > max_records) {
+            max_records = lanes[w].records;
+        }
+    }
+    printf("Router %d: routed %ld record(s) in %ld batch(es) to %d "
+           "worker(s) by source IP in %.3f ms\n", rank, routed, batches,
+           num_workers, get_time_ms() - start_time);
+    printf("Router %d: per-worker records %ld .. %ld, %ld credit "
+           "stall(s), %d ring range(s) moved\n", rank, min_records,
+           max_records, stalls, moves);
+    if (hot.splits > 0) {
+        printf("Router %d: %ld hot source(s) split over up to %d workers, "
+               "%ld record(s) spread\n", rank, hot.splits, hot.max_width,
+               hot.split_records);
+    }
+    if (residual[0] > 0) {
+        printf("Router %d: dropped %ld record(s), %ld packet(s) from "
+               "%d blocked source(s) at ingest\n", rank, residual[0],
+               residual[1], bl->set.count);
+    }
+
+    /* same collectives as a streaming worker */
+    TalkerSummary no_traffic;
+    talkers_init(&no_traffic);
+    talkers_reduce(&no_traffic, NULL);
+    blocklist_close(bl);
+    MPI_Reduce(residual, NULL, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double no_comm[2] = { 0.0, 0.0 };  /* sends no window alerts */
+    MPI_Reduce(no_comm, NULL, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (cfg->mpiio_log) {
+        AlertLog none;
+        alert_log_init(&none);
+        alert_log_write(&none, ALERT_LOG_PATH);
+    }
+
+    for (int w = 0; w < num_workers; w++) {
+        for (int s = 0; s < ROUTER_CREDITS; s++) {
+            free(lanes[w].buf[s]);
+        }
+    }
+    ring_free(&ring);
+    free(load);
+    free(line);
+    free(lanes);
+    free(bl);
+}
+
+/* ==============================
+   Worker side of the router stream
+   ============================== */
+int flow_source_open_router(FlowSource *src, int rank, int router,
+                            int follow_idle_s)
+{
+    memset(src, 0, sizeof(FlowSource));
+    src->rank = rank;
+    src->router = router;
+    src->follow_idle_s = follow_idle_s;
+    snprintf(src->path, sizeof(src->path), "router rank %d", router);
+    for (int i = 0; i < RING_MAX_MOVES; i++) {
+        src->state_req[i] = MPI_REQUEST_NULL;
+    }
+
+    src->batch = malloc(sizeof(FlowRecord) * ROUTER_BATCH);
+    return src->batch ? 0 : -1;
+}
+
+/*
+   Applies queued ring handoffs.  For a range this worker gave up, the
+   talker state of its sources goes to the new owner; for a range it
+   took over, one such state message is expected.  Arrived states are
+   merged into src->state.  With final set, waits for every expected
+   state and every send.  Only call when every record read so far has
+   been added to src->state.
+*/
+void router_handoff(FlowSource *src, int final)
+{
+    for (int m = 0; m < src->move_count; m++) {
+        const RingMove *move = &src->moves[m];
+        if (move->to == src->rank) {
+            src->states_expected++;
+            continue;
+        }
+
+        /* reuse a slot whose earlier send has completed */
+        int slot = -1;
+        for (int i = 0; i < RING_MAX_MOVES && slot < 0; i++) {
+            int done = 1;
+            if (src->state_out[i]) {
+                MPI_Test(&src->state_req[i], &done, MPI_STATUS_IGNORE);
+            }
+            if (done) slot = i;
+        }
+        if (slot < 0) {
+            MPI_Waitany(RING_MAX_MOVES, src->state_req, &slot,
+                        MPI_STATUS_IGNORE);
+        }
+        if (!src->state_out[slot]) {
+            src->state_out[slot] = malloc(sizeof(TalkerSummary));
+            if (!src->state_out[slot]) {
+                fprintf(stderr, "Worker %d: handoff allocation failed\n",
+                        src->rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        talkers_split_range(src->state, move->lo, move->hi,
+                            src->state_out[slot]);
+        talkers_isend(src->state_out[slot], move->to, TAG_STATE,
+                      &src->state_req[slot]);
+        printf("Worker %d: handed %d talker(s) of ring range (%08x, %08x] "
+               "to worker %d\n", src->rank, src->state_out[slot]->count,
+               move->lo, move->hi, move->to);
+    }
+    src->move_count = 0;
+
+    for (;;) {
+        int flag = 0;
+        MPI_Status status;
+        if (final && src->states_received < src->states_expected) {
+            MPI_Probe(MPI_ANY_SOURCE, TAG_STATE, MPI_COMM_WORLD, &status);
+            flag = 1;
+        } else {
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_STATE, MPI_COMM_WORLD, &flag,
+                       &status);
+        }
+        if (!flag) break;
+        talkers_recv_merge(src->state, status.MPI_SOURCE, TAG_STATE);
+        src->states_received++;
+    }
+
+    if (final) {
+        for (int i = 0; i < RING_MAX_MOVES; i++) {
+            if (src->state_out[i]) {
+                MPI_Wait(&src->state_req[i], MPI_STATUS_IGNORE);
+                free(src->state_out[i]);
+                src->state_out[i] = NULL;
+            }
+        }
+    }
+}
+
+/*
+   Fills up to max_records from the router's batches, returning a credit
+   for each batch used up.  With --follow a short read returns what has
+   arrived; otherwise it blocks until the window is full or the stream
+   ends.  Returns 0 at the end of the stream.
+
+   Handoffs arrive in order with the batches.  They are applied before
+   anything is read in this call, or queued until the next call once
+   this window holds records.
+*/
+int router_read(FlowSource *src, FlowRecord *records, int max_records)
+{
+    int count = 0;
+
+    router_handoff(src, 0);
+    while (count < max_records && !src->router_ended) {
+        if (src->batch_pos == src->batch_count) {
+            if (src->batch_count > 0) {
+                int grant = 1;
+                MPI_Send(&grant, 1, MPI_INT, src->router, TAG_CREDIT,
+                         MPI_COMM_WORLD);
+                src->batch_count = 0;
+                src->batch_pos = 0;
+            }
+            if (count > 0 && src->follow_idle_s > 0) {
+                int flag = 0;
+                MPI_Iprobe(src->router, MPI_ANY_TAG, MPI_COMM_WORLD, &flag,
+                           MPI_STATUS_IGNORE);
+                if (!flag) break;
+            }
+
+            MPI_Status status;
+            MPI_Probe(src->router, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+            if (status.MPI_TAG == TAG_HANDOFF) {
+                uint32_t msg[4];
+                MPI_Recv(msg, 4, MPI_UINT32_T, src->router, TAG_HANDOFF,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                RingMove *move = &src->moves[src->move_count++];
+                move->lo = msg[0];
+                move->hi = msg[1];
+                move->from = (int)msg[2];
+                move->to = (int)msg[3];
+                if (count == 0) {
+                    router_handoff(src, 0);
+                } else if (src->move_count == RING_MAX_MOVES) {
+                    break;
+                }
+                continue;
+            }
+            MPI_Recv(src->batch, ROUTER_BATCH, record_type, src->router,
+                     TAG_BATCH, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, record_type, &src->batch_count);
+            if (src->batch_count == 0) {
+                src->router_ended = 1;
+                break;
+            }
+        }
+
+        const FlowRecord *r = &src->batch[src->batch_pos++];
+        if (src->filter && src->filter->count > 0) {
+            uint32_t addr;
+            if (ip_to_u32(r->src_ip, &addr) == 0 &&
+                blockset_contains(src->filter, addr)) {
+                /* routed before the block reached the router */
+                src->filtered_records++;
+                src->filtered_packets += r->packets;
+                continue;
+            }
+        }
+        records[count++] = *r;
+    }
+
+    src->records_read += count;
+    return count;
+}
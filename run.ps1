@@ -56,7 +56,8 @@ if (Test-Path $Dataset) {
 # Step 4: Create CSV headers
 Write-Host ""
 Write-Host "[4/5] Initializing result files..." -ForegroundColor Green
-"worker_rank,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip" | Out-File -FilePath "results\metrics\alerts.csv" -Encoding ASCII
+"worker_rank,window_id,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,hw_detected,shift_detected,shift_score,rate_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip,worker_count" | Out-File -FilePath "results\metrics\alerts.csv" -Encoding ASCII
+"detection_latency_ms,throughput_pps,throughput_gbps,packets_processed,bytes_processed,true_positives,false_positives,true_negatives,false_negatives,cpu_usage_percent,memory_usage_kb,mpi_comm_overhead_ms" | Out-File -FilePath "results\metrics\performance.csv" -Encoding ASCII
 "blocked_ip,attack_packets_blocked,legitimate_packets_blocked,blocking_efficiency,collateral_damage,block_time_ms" | Out-File -FilePath "results\metrics\blocking.csv" -Encoding ASCII
 "" | Out-File -FilePath "results\metrics\iptables_rules.txt" -Encoding ASCII
 Write-Host "  ✓ Result files initialized" -ForegroundColor Green
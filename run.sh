@@ -46,7 +46,8 @@ fi
 # Step 4: Create CSV headers
 echo ""
 echo "[4/5] Initializing result files..."
-echo "worker_rank,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip" > results/metrics/alerts.csv
+echo "worker_rank,window_id,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,hw_detected,shift_detected,shift_score,rate_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip,worker_count" > results/metrics/alerts.csv
+echo "detection_latency_ms,throughput_pps,throughput_gbps,packets_processed,bytes_processed,true_positives,false_positives,true_negatives,false_negatives,cpu_usage_percent,memory_usage_kb,mpi_comm_overhead_ms" > results/metrics/performance.csv
 echo "blocked_ip,attack_packets_blocked,legitimate_packets_blocked,blocking_efficiency,collateral_damage,block_time_ms" > results/metrics/blocking.csv
 echo "" > results/metrics/iptables_rules.txt
 echo "  ✓ Result files initialized"
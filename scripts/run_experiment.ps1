@@ -23,7 +23,7 @@ New-Item -ItemType Directory -Force -Path $MetricsDir | Out-Null
 New-Item -ItemType Directory -Force -Path $PlotsDir | Out-Null
 
 # Write CSV headers
-"worker_rank,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,global_attack,chosen_ip,processing_time_ms,memory_used_kb" | Out-File -FilePath (Join-Path $MetricsDir "alerts.csv") -Encoding UTF8
+"worker_rank,window_id,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,hw_detected,shift_detected,shift_score,rate_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip,worker_count" | Out-File -FilePath (Join-Path $MetricsDir "alerts.csv") -Encoding UTF8
 "detection_latency_ms,throughput_pps,throughput_gbps,packets_processed,bytes_processed,true_positives,false_positives,true_negatives,false_negatives,cpu_usage_percent,memory_usage_kb,mpi_comm_overhead_ms" | Out-File -FilePath (Join-Path $MetricsDir "performance.csv") -Encoding UTF8
 "blocked_ip,attack_packets_blocked,legitimate_packets_blocked,blocking_efficiency,collateral_damage,block_time_ms" | Out-File -FilePath (Join-Path $MetricsDir "blocking.csv") -Encoding UTF8
 
@@ -27,7 +27,7 @@ mkdir -p ${METRICS_DIR}
 mkdir -p ${PLOTS_DIR}
 
 # Write CSV headers
-echo "worker_rank,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,global_attack,chosen_ip,processing_time_ms,memory_used_kb" > ${METRICS_DIR}/alerts.csv
+echo "worker_rank,window_id,attack_flag,suspicious_ip,entropy,avg_rate,spike_score,total_packets,total_flows,entropy_detected,cusum_detected,ml_detected,hw_detected,shift_detected,shift_score,rate_detected,processing_time_ms,memory_used_kb,global_attack,chosen_ip,worker_count" > ${METRICS_DIR}/alerts.csv
 echo "detection_latency_ms,throughput_pps,throughput_gbps,packets_processed,bytes_processed,true_positives,false_positives,true_negatives,false_negatives,cpu_usage_percent,memory_usage_kb,mpi_comm_overhead_ms" > ${METRICS_DIR}/performance.csv
 echo "blocked_ip,attack_packets_blocked,legitimate_packets_blocked,blocking_efficiency,collateral_damage,block_time_ms" > ${METRICS_DIR}/blocking.csv
 
@@ -0,0 +1,174 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Node-shared dataset
+   ============================== */
+/*
+   With --shared, the worker ranks of each node (MPI_COMM_TYPE_SHARED)
+   elect their lowest rank as leader.  The leader sizes one
+   MPI_Win_allocate_shared region from the line counts of the node's
+   partitions and parses every partition straight into it; each rank
+   then analyzes its own slice in place.  A node holds its records once,
+   sized to the data, instead of one MAX_FLOWS buffer per rank, and only
+   one process per node touches the files.
+*/
+
+/* newline count: an upper bound on the records in a partition */
+static long count_lines(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+    char buf[65536];
+    long lines = 0;
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            lines += (buf[i] == '\n');
+        }
+    }
+    fclose(fp);
+    return lines + 1;           /* last line may lack its newline */
+}
+
+static void partition_path(char *out, size_t size, const char *root, int rank)
+{
+    snprintf(out, size, "%s/partitions/part_%d.csv", root, rank);
+}
+
+/*
+   Collective over MPI_COMM_WORLD.  The coordinator (rank 0) takes part
+   only in the split and gets an empty dataset.  On a worker, ds->records
+   and ds->count describe its slice of the node region.
+*/
+int shared_dataset_load(int rank, const DetectorConfig *cfg,
+                        SharedDataset *ds)
+{
+    memset(ds, 0, sizeof(SharedDataset));
+    ds->workers = MPI_COMM_NULL;
+    ds->node = MPI_COMM_NULL;
+    ds->win = MPI_WIN_NULL;
+
+    MPI_Comm_split(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : 1, rank,
+                   &ds->workers);
+    if (ds->workers == MPI_COMM_NULL) {
+        return 0;
+    }
+    MPI_Comm_split_type(ds->workers, MPI_COMM_TYPE_SHARED, rank,
+                        MPI_INFO_NULL, &ds->node);
+
+    int node_rank = 0;
+    MPI_Comm_rank(ds->node, &node_rank);
+    MPI_Comm_size(ds->node, &ds->node_ranks);
+
+    /* leader learns the members, sizes the region from line counts */
+    int *members = NULL;
+    long *capacity = NULL;
+    long *slices = NULL;        /* offset, count per member */
+    if (node_rank == 0) {
+        members = malloc(sizeof(int) * ds->node_ranks);
+        capacity = malloc(sizeof(long) * ds->node_ranks);
+        slices = malloc(sizeof(long) * 2 * ds->node_ranks);
+        if (!members || !capacity || !slices) {
+            fprintf(stderr, "Worker %d: shared dataset allocation failed\n",
+                    rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(&rank, 1, MPI_INT, members, 1, MPI_INT, 0, ds->node);
+
+    long total = 0;
+    if (node_rank == 0) {
+        for (int m = 0; m < ds->node_ranks; m++) {
+            char path[512];
+            partition_path(path, sizeof(path), cfg->dataset_root, members[m]);
+            capacity[m] = count_lines(path);
+            if (capacity[m] > MAX_FLOWS) capacity[m] = MAX_FLOWS;
+            total += capacity[m];
+        }
+    }
+
+    FlowRecord *base = NULL;
+    MPI_Aint bytes = 0;
+    if (node_rank == 0) {
+        bytes = (MPI_Aint)(total * sizeof(FlowRecord));
+    }
+    MPI_Win_allocate_shared(bytes, sizeof(FlowRecord), MPI_INFO_NULL,
+                            ds->node, &base, &ds->win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, ds->win);
+
+    if (node_rank == 0) {
+        long offset = 0;
+        for (int m = 0; m < ds->node_ranks; m++) {
+            char path[512];
+            FlowSource src;
+            int count = 0;
+
+            partition_path(path, sizeof(path), cfg->dataset_root, members[m]);
+            if (capacity[m] > 0 &&
+                flow_source_open_path(&src, members[m], path, 0) == 0) {
+                count = flow_source_read(&src, base + offset,
+                                         (int)capacity[m]);
+                flow_source_close(&src);
+            } else {
+                fprintf(stderr, "Worker %d: could not open %s\n",
+                        members[m], path);
+            }
+            slices[2 * m]     = offset;
+            slices[2 * m + 1] = count;
+            offset += capacity[m];
+            ds->node_records += count;
+        }
+        printf("Worker %d: node leader loaded %ld records for %d rank(s) "
+               "into shared memory (%ld KB)\n",
+               rank, ds->node_records, ds->node_ranks,
+               (long)(bytes / 1024));
+    }
+
+    /* publish the leader's writes before anyone reads its slice */
+    MPI_Win_sync(ds->win);
+    MPI_Barrier(ds->node);
+    MPI_Win_sync(ds->win);
+
+    long slice[2];
+    MPI_Scatter(slices, 2, MPI_LONG, slice, 2, MPI_LONG, 0, ds->node);
+
+    MPI_Aint region_size;
+    int disp_unit;
+    FlowRecord *region = NULL;
+    MPI_Win_shared_query(ds->win, 0, &region_size, &disp_unit, &region);
+    ds->records = region + slice[0];
+    ds->count = (int)slice[1];
+
+    if (ds->count > 0) {
+        printf("Worker %d: mapped %d records from the node region\n",
+               rank, ds->count);
+    }
+
+    free(slices);
+    free(capacity);
+    free(members);
+    return ds->count;
+}
+
+/* collective over the node's worker ranks; a no-op on the coordinator */
+void shared_dataset_free(SharedDataset *ds)
+{
+    if (ds->win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(ds->win);
+        MPI_Win_free(&ds->win);
+    }
+    if (ds->node != MPI_COMM_NULL) {
+        MPI_Comm_free(&ds->node);
+    }
+    if (ds->workers != MPI_COMM_NULL) {
+        MPI_Comm_free(&ds->workers);
+    }
+    ds->records = NULL;
+    ds->count = 0;
+}
@@ -0,0 +1,587 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Streaming service mode
+   ============================== */
+/*
+   Workers read their partition in windows of cfg->window_records
+   records (optionally tailing the file for appended lines) and send one
+   Alert per window, tagged with its sequence number.  A TAG_STREAM_END
+   message carries the number of windows sent.
+
+   The coordinator keeps up to STREAM_SLOTS windows open and decides
+   them in order: window N is decided as soon as every worker has either
+   reported N or ended its stream.  If a fast worker runs STREAM_SLOTS
+   windows ahead, the oldest open window is decided with the alerts it
+   has and later alerts for it are counted as late.
+
+   Workers also fold every window into a TalkerSummary; the summaries
+   are reduced once after the stream ends for run-wide top talkers.
+   Blocked IPs are broadcast back to the workers (blocklist.c), which
+   drop those sources at ingest and report the residual traffic.
+
+   With --deadline, a window is also decided once its first alert is
+   that old; the workers it still lacks are named and their alerts for
+   it arrive late, so one slow node cannot hold back every decision.
+*/
+
+typedef struct {
+    int    window_id;           /* -1 = free */
+    int    received;
+    double first_arrival_ms;
+    Alert *alerts;              /* num_workers entries */
+} WindowSlot;
+
+typedef struct {
+    int    windows_decided;
+    int    attack_windows;
+    int    partial_windows;     /* decided before every worker reported */
+    int    deadline_windows;    /* of which forced by --deadline */
+    int    late_alerts;
+    long   packets;
+    double latency_sum_ms;
+    double latency_max_ms;
+} StreamSummary;
+
+/*
+   Double-buffered window sends: window N's alert is packed into one of
+   two buffers and sent with MPI_Isend while window N+1 is read and
+   analyzed.  A send counts as overlapped if it has completed by the
+   time the next window's analysis is done; time spent blocked waiting
+   for a buffer is reported separately.  Message sizes vary with the
+   suspect list, so these are plain MPI_Isend rather than persistent
+   requests.
+*/
+typedef struct {
+    char *buf[2];
+    MPI_Request req[2];
+    int bytes;                  /* capacity of each buffer */
+    int sends;
+    int overlapped;
+    double wait_ms;
+} SendPipeline;
+
+static int send_pipeline_init(SendPipeline *p)
+{
+    memset(p, 0, sizeof(SendPipeline));
+    p->bytes = wire_max_bytes();
+    for (int i = 0; i < 2; i++) {
+        p->buf[i] = malloc(p->bytes);
+        p->req[i] = MPI_REQUEST_NULL;
+    }
+    return (p->buf[0] && p->buf[1]) ? 0 : -1;
+}
+
+/* after computing the next window: did the previous send finish? */
+static void send_pipeline_check(SendPipeline *p)
+{
+    if (p->sends == 0) {
+        return;
+    }
+    int done = 0;
+    MPI_Test(&p->req[(p->sends - 1) % 2], &done, MPI_STATUS_IGNORE);
+    if (done) {
+        p->overlapped++;
+    }
+}
+
+static void send_pipeline_post(SendPipeline *p, const Alert *alert, int tag)
+{
+    int slot = p->sends % 2;
+    if (p->req[slot] != MPI_REQUEST_NULL) {
+        double t0 = get_time_ms();
+        MPI_Wait(&p->req[slot], MPI_STATUS_IGNORE);
+        p->wait_ms += get_time_ms() - t0;
+    }
+    int bytes = alert_pack(alert, p->buf[slot], p->bytes);
+    MPI_Isend(p->buf[slot], bytes, MPI_PACKED, 0, tag, MPI_COMM_WORLD,
+              &p->req[slot]);
+    p->sends++;
+}
+
+static void send_pipeline_finish(SendPipeline *p)
+{
+    double t0 = get_time_ms();
+    MPI_Waitall(2, p->req, MPI_STATUSES_IGNORE);
+    p->wait_ms += get_time_ms() - t0;
+    free(p->buf[0]);
+    free(p->buf[1]);
+    p->buf[0] = p->buf[1] = NULL;
+}
+
+/* ==============================
+   Worker side
+   ============================== */
+void worker_stream(int rank, int world_size, const DetectorConfig *cfg)
+{
+    int window = cfg->window_records > 0 ? cfg->window_records : STREAM_WINDOW;
+    int window_id = 0;
+    Alert alert;
+    TalkerSummary talkers;
+    talkers_init(&talkers);
+
+    FlowRecord *records = malloc(sizeof(FlowRecord) * window);
+    IpStat *stats = malloc(sizeof(IpStat) * MAX_UNIQUE_IPS);
+    Blocklist *bl = malloc(sizeof(Blocklist));
+    FlowSource src;
+    AlertLog log;
+    long residual[2] = { 0, 0 };    /* records, packets dropped at ingest */
+    double comm[2] = { 0.0, 0.0 };  /* ms in per-window MPI calls, windows */
+    alert_log_init(&log);
+
+    if (!bl) {
+        fprintf(stderr, "Worker %d: blocklist allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    blocklist_open(bl, rank);
+
+    int opened = -1;
+    if (!records || !stats) {
+        fprintf(stderr, "Worker %d: stream allocation failed\n", rank);
+    } else if (cfg->router_input) {
+        opened = flow_source_open_router(&src, rank, world_size - 1,
+                                         cfg->follow_idle_s);
+    } else {
+        opened = flow_source_open(&src, rank, cfg->dataset_root,
+                                  cfg->follow_idle_s);
+    }
+    if (opened != 0 && cfg->router_input) {
+        /* the router would wait forever for this worker's credits */
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (opened == 0) {
+        DetectorContext detectors;
+        CascadeStats cascade;
+        SendPipeline pipe;
+        detector_context_init(&detectors, cfg);
+        memset(&cascade, 0, sizeof(CascadeStats));
+        if (send_pipeline_init(&pipe) != 0) {
+            fprintf(stderr, "Worker %d: send buffer allocation failed\n",
+                    rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        src.filter = &bl->set;
+        src.state = &talkers;
+
+        for (;;) {
+            double c0 = get_time_ms();
+            blocklist_poll(bl);
+            comm[0] += get_time_ms() - c0;
+            int n = flow_source_read(&src, records, window);
+            if (n <= 0) break;
+
+            double t0 = get_time_ms();
+            int stat_count = analyze_window(&detectors, records, n, stats,
+                                            rank, window_id, &cascade, &alert);
+            talkers_add_stats(&talkers, stats, stat_count);
+            alert.processing_time_ms = get_time_ms() - t0;
+            if (cfg->mpiio_log) {
+                alert_log_add(&log, &alert);
+            }
+
+            c0 = get_time_ms();
+            send_pipeline_check(&pipe);
+            send_pipeline_post(&pipe, &alert, TAG_ALERT);
+            comm[0] += get_time_ms() - c0;
+            window_id++;
+        }
+        comm[1] = window_id;
+        send_pipeline_finish(&pipe);
+        if (src.router > 0) {
+            router_handoff(&src, 1);
+        }
+
+        /* the last send has no following window to hide behind */
+        int measured = pipe.sends > 1 ? pipe.sends - 1 : 0;
+        printf("Worker %d: streamed %d window(s), %ld records from %s\n",
+               rank, window_id, src.records_read, src.path);
+        printf("Worker %d: send overlap ratio %.2f (%d/%d sends hidden), "
+               "%.3f ms blocked in sends\n",
+               rank, measured > 0 ? (double)pipe.overlapped / measured : 0.0,
+               pipe.overlapped, measured, pipe.wait_ms);
+        if (src.filtered_records > 0) {
+            printf("Worker %d: dropped %ld record(s), %ld packet(s) from "
+                   "%d blocked source(s) at ingest\n", rank,
+                   src.filtered_records, src.filtered_packets,
+                   bl->set.count);
+        }
+        residual[0] = src.filtered_records;
+        residual[1] = src.filtered_packets;
+        if (cfg->cascade) {
+            print_cascade_stats(rank, &cascade);
+        }
+
+        flow_source_close(&src);
+        detector_context_free(&detectors);
+    }
+
+    /* always end the stream so the coordinator can retire this worker */
+    memset(&alert, 0, sizeof(Alert));
+    alert.worker_rank = rank;
+    alert.window_id = window_id;
+    alert_send(&alert, 0, TAG_STREAM_END);
+
+    /* run-wide top talkers, merged once at the end of the stream */
+    talkers_reduce(&talkers, NULL);
+
+    blocklist_close(bl);
+    MPI_Reduce(residual, NULL, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(comm, NULL, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (cfg->mpiio_log) {
+        alert_log_write(&log, ALERT_LOG_PATH);
+    }
+    free(bl);
+
+    free(stats);
+    free(records);
+}
+
+/* ==============================
+   Coordinator side
+   ============================== */
+/* every worker has reported `window_id` or ended its stream */
+static int window_complete(int window_id, const int *next_window,
+                           const int *ended, int num_workers)
+{
+    for (int w = 0; w < num_workers; w++) {
+        if (!ended[w] && next_window[w] <= window_id) return 0;
+    }
+    return 1;
+}
+
+/* with `log` set (--mpiio), only the verdict is kept, for the run's end */
+static void decide_window(WindowSlot *slot, int forced,
+                          char (*blocked)[IP_STR_LEN], int *blocked_count,
+                          Blocklist *bl, StreamSummary *summary,
+                          AlertLog *log)
+{
+    AlertTally tally;
+    tally_init(&tally);
+    for (int i = 0; i < slot->received; i++) {
+        tally_add(&tally, &slot->alerts[i], i);
+    }
+    int global_attack = 0;
+    char chosen_ip[IP_STR_LEN];
+    chosen_ip[0] = '\0';
+
+    if (tally.attack_votes >= 2 && tally.chosen_index != -1) {
+        global_attack = 1;
+        strncpy(chosen_ip, slot->alerts[tally.chosen_index].suspicious_ip,
+                IP_STR_LEN - 1);
+        chosen_ip[IP_STR_LEN - 1] = '\0';
+
+        /* the window's whole suspect set is blocked in this decision */
+        int added = block_ip_once(chosen_ip, blocked, blocked_count, bl);
+        added += block_suspect_set(&tally, blocked, blocked_count, bl);
+        if (!bl->async) {
+            blocking_log_flush();   /* the action thread flushes its own */
+        }
+
+        printf("[COORDINATOR] window %d: attack CONFIRMED, %s "
+               "(votes %d / %d, %d suspect(s), %d newly blocked)\n",
+               slot->window_id, chosen_ip, tally.attack_votes,
+               slot->received, tally.suspect_count, added);
+        summary->attack_windows++;
+    }
+
+    if (log) {
+        alert_log_verdict(log, slot->window_id, global_attack, chosen_ip);
+    } else if (bl->async) {
+        coord_threads_log(bl->async, slot->alerts, slot->received,
+                          global_attack, chosen_ip);
+    } else {
+        append_alert_log(slot->alerts, slot->received, global_attack,
+                         chosen_ip);
+    }
+
+    for (int i = 0; i < slot->received; i++) {
+        summary->packets += slot->alerts[i].total_packets;
+    }
+
+    double latency = get_time_ms() - slot->first_arrival_ms;
+    summary->latency_sum_ms += latency;
+    if (latency > summary->latency_max_ms) {
+        summary->latency_max_ms = latency;
+    }
+    if (forced) {
+        summary->partial_windows++;
+    }
+    summary->windows_decided++;
+
+    slot->window_id = -1;
+    slot->received = 0;
+}
+
+/*
+   Polls for the next worker message until `deadline` (absolute ms).
+   Returns 1 when one is waiting, 0 once the deadline has passed.
+*/
+static int wait_message(double deadline)
+{
+    for (;;) {
+        int flag = 0;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag,
+                   MPI_STATUS_IGNORE);
+        if (flag) {
+            return 1;
+        }
+        if (get_time_ms() >= deadline) {
+            return 0;
+        }
+        sleep_ms(1);
+    }
+}
+
+/*
+   Next worker message into msg, *source and *tag; 0 once `deadline`
+   (absolute ms, 0 = none) passes first.  With --threaded it comes from
+   the comm thread.
+*/
+static int next_message(CoordThreads *ct, double deadline, Alert *msg,
+                        int *source, int *tag)
+{
+    if (ct) {
+        return coord_threads_next(ct, deadline, msg, source, tag);
+    }
+    if (deadline > 0.0 && !wait_message(deadline)) {
+        return 0;
+    }
+    MPI_Status status;
+    alert_recv(msg, MPI_ANY_SOURCE, MPI_ANY_TAG, &status);
+    *source = status.MPI_SOURCE;
+    *tag = status.MPI_TAG;
+    return 1;
+}
+
+/* names the workers that have not reported `window_id` and counts them */
+static void mark_missing(int window_id, const int *next_window,
+                         const int *ended, int *missed, int num_workers)
+{
+    printf("[COORDINATOR] window %d: deadline reached, missing rank(s)",
+           window_id);
+    for (int w = 0; w < num_workers; w++) {
+        if (!ended[w] && next_window[w] <= window_id) {
+            printf(" %d", w + 1);
+            missed[w]++;
+        }
+    }
+    printf("\n");
+}
+
+void coordinator_stream(int world_size, const DetectorConfig *cfg)
+{
+    /* the router rank, if any, is last and sends no alerts */
+    int num_workers = world_size - 1 - (cfg->router_input ? 1 : 0);
+    if (num_workers <= 0) {
+        fprintf(stderr, "Coordinator: no workers\n");
+        return;
+    }
+
+    Blocklist *bl = malloc(sizeof(Blocklist));
+    if (!bl) {
+        fprintf(stderr, "Coordinator: blocklist allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    blocklist_open(bl, 0);
+
+    WindowSlot *slots = calloc(STREAM_SLOTS, sizeof(WindowSlot));
+    Alert *alert_pool = malloc(sizeof(Alert) * STREAM_SLOTS * num_workers);
+    int *next_window = calloc(num_workers, sizeof(int));
+    int *ended = calloc(num_workers, sizeof(int));
+    int *missed = calloc(num_workers, sizeof(int));
+    char (*blocked)[IP_STR_LEN] = malloc(IP_STR_LEN * MAX_BLOCKED_IPS);
+
+    if (!slots || !alert_pool || !next_window || !ended || !missed ||
+        !blocked) {
+        fprintf(stderr, "Coordinator: stream allocation failed\n");
+        free(slots); free(alert_pool); free(next_window);
+        free(ended); free(missed); free(blocked);
+        return;
+    }
+    for (int i = 0; i < STREAM_SLOTS; i++) {
+        slots[i].window_id = -1;
+        slots[i].alerts = alert_pool + (size_t)i * num_workers;
+    }
+
+    StreamSummary summary;
+    memset(&summary, 0, sizeof(StreamSummary));
+    AlertLog log;
+    alert_log_init(&log);
+    AlertLog *verdict_log = cfg->mpiio_log ? &log : NULL;
+    int blocked_count = 0;
+    int active = num_workers;
+    int next_decide = 0;
+    double start_time = get_time_ms();
+
+    printf("[COORDINATOR] streaming mode: %d worker(s), %d records/window\n",
+           num_workers, cfg->window_records);
+    CoordThreads *ct = NULL;
+    if (cfg->threaded) {
+        ct = coord_threads_start(bl);
+        if (ct) {
+            printf("[COORDINATOR] threaded: comm, decision and action "
+                   "threads\n");
+        } else {
+            fprintf(stderr, "Coordinator: could not start threads, "
+                            "coordinating on one thread\n");
+        }
+    }
+
+    for (;;) {
+        /* decide every window that can no longer change, in order */
+        for (;;) {
+            WindowSlot *slot = &slots[next_decide % STREAM_SLOTS];
+            if (!window_complete(next_decide, next_window, ended,
+                                 num_workers)) {
+                break;
+            }
+            if (slot->window_id != next_decide) {
+                break;          /* nothing left: every worker ended */
+            }
+            decide_window(slot, 0, blocked, &blocked_count, bl, &summary,
+                          verdict_log);
+            next_decide++;
+        }
+        /* push new blocks to the workers without waiting on them */
+        if (!ct) {
+            blocklist_flush(bl, 0);
+        }
+        if (active == 0) {
+            break;
+        }
+
+        /* an open window past its deadline is decided with what it has */
+        WindowSlot *oldest = &slots[next_decide % STREAM_SLOTS];
+        double deadline = 0.0;
+        if (cfg->deadline_ms > 0 && oldest->window_id == next_decide) {
+            deadline = oldest->first_arrival_ms + cfg->deadline_ms;
+        }
+        Alert msg;
+        int source = 0, tag = 0;
+        if (!next_message(ct, deadline, &msg, &source, &tag)) {
+            mark_missing(next_decide, next_window, ended, missed,
+                         num_workers);
+            decide_window(oldest, 1, blocked, &blocked_count, bl, &summary,
+                          verdict_log);
+            summary.deadline_windows++;
+            next_decide++;
+            continue;
+        }
+
+        int w = source - 1;
+
+        if (tag == TAG_STREAM_END) {
+            ended[w] = 1;
+            active--;
+            continue;
+        }
+
+        int id = msg.window_id;
+        next_window[w] = id + 1;
+        if (id < next_decide) {
+            summary.late_alerts++;
+            continue;
+        }
+
+        /* slot pressure: close the oldest window with what it has */
+        while (id >= next_decide + STREAM_SLOTS) {
+            WindowSlot *oldest = &slots[next_decide % STREAM_SLOTS];
+            if (oldest->window_id == next_decide) {
+                decide_window(oldest, 1, blocked, &blocked_count, bl,
+                              &summary, verdict_log);
+            }
+            next_decide++;
+        }
+
+        WindowSlot *slot = &slots[id % STREAM_SLOTS];
+        if (slot->window_id != id) {
+            slot->window_id = id;
+            slot->received = 0;
+            slot->first_arrival_ms = get_time_ms();
+        }
+        slot->alerts[slot->received++] = msg;
+    }
+
+    double elapsed_ms = get_time_ms() - start_time;
+    if (ct) {
+        coord_threads_stop(ct);     /* MPI is on this thread again */
+    }
+
+    TalkerSummary no_traffic, global;
+    talkers_init(&no_traffic);
+    talkers_reduce(&no_traffic, &global);
+
+    char hot[MAX_SUSPECTS][IP_STR_LEN];
+    int hot_count = talkers_report(&global, hot, MAX_SUSPECTS);
+    for (int i = 0; i < hot_count; i++) {
+        if (already_blocked(blocked, blocked_count, hot[i]) ||
+            blocked_count >= MAX_BLOCKED_IPS) {
+            continue;
+        }
+        printf("[COORDINATOR] Cross-partition heavy hitter CONFIRMED: %s\n",
+               hot[i]);
+        block_ip_once(hot[i], blocked, &blocked_count, bl);
+    }
+    blocking_log_flush();
+
+    blocklist_close(bl);
+    int broadcasts = bl->broadcasts;
+    long residual[2] = { 0, 0 }, no_residual[2] = { 0, 0 };
+    MPI_Reduce(no_residual, residual, 2, MPI_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+    double comm[2] = { 0.0, 0.0 }, no_comm[2] = { 0.0, 0.0 };
+    MPI_Reduce(no_comm, comm, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (cfg->mpiio_log) {
+        alert_log_write(&log, ALERT_LOG_PATH);
+    }
+
+    int decided = summary.windows_decided > 0 ? summary.windows_decided : 1;
+
+    printf("\n[COORDINATOR] Stream finished.\n");
+    printf("  Windows decided: %d (%d attack, %d partial, %d late alerts)\n",
+           summary.windows_decided, summary.attack_windows,
+           summary.partial_windows, summary.late_alerts);
+    printf("  Decision latency: avg %.3f ms, max %.3f ms\n",
+           summary.latency_sum_ms / decided, summary.latency_max_ms);
+    if (cfg->deadline_ms > 0) {
+        printf("  Deadline %d ms: %d window(s) decided without every "
+               "worker\n", cfg->deadline_ms, summary.deadline_windows);
+        for (int w = 0; w < num_workers; w++) {
+            if (missed[w] > 0) {
+                printf("    rank %d missed %d window(s)\n", w + 1,
+                       missed[w]);
+            }
+        }
+    }
+    printf("  Blocked IPs: %d (%d %sblocklist broadcast(s) to workers)\n",
+           blocked_count, broadcasts, bl->persistent ? "persistent " : "");
+    /* alert sends and blocklist polls, per window of one worker */
+    double comm_per_window = comm[1] > 0.0 ? comm[0] / comm[1] : 0.0;
+    printf("  Per-window MPI time on workers: %.3f ms (%.0f window(s))\n",
+           comm_per_window, comm[1]);
+    printf("  Residual traffic from blocked sources: %ld record(s), "
+           "%ld packet(s), dropped at ingest\n", residual[0], residual[1]);
+
+    PerformanceMetrics metrics;
+    init_performance_metrics(&metrics);
+    metrics.detection_latency_ms = summary.latency_sum_ms / decided;
+    metrics.packets_processed = (int)summary.packets;
+    if (elapsed_ms > 0.0) {
+        metrics.throughput_pps = summary.packets / (elapsed_ms / 1000.0);
+    }
+    metrics.mpi_comm_overhead_ms = comm_per_window;
+    log_performance_metrics(&metrics, "results/metrics/performance.csv");
+
+    free(bl);
+    free(blocked);
+    free(missed);
+    free(ended);
+    free(next_window);
+    free(alert_pool);
+    free(slots);
+}
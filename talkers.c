@@ -0,0 +1,355 @@
+#include <mpi.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Global top talkers (MPI_Reduce with a merge operator)
+   ============================== */
+/*
+   Each worker keeps a fixed-size TalkerSummary of its traffic:
+
+   - the TALKER_SLOTS heaviest sources with their packet/byte counts,
+     plus an error bound on each packet count;
+   - a floor, which bounds the packets of any source that is not listed;
+   - packet counts of every source hashed into TALKER_BUCKETS bins.
+
+   Summaries are merged with a user-defined MPI_Op, so rank 0 receives
+   one summary of the same size whatever the data volume.  A listed
+   source with error 0 has an exact global total.  Global entropy is
+   taken over the hash bins.  Collisions can only merge sources, so the
+   estimate never overstates the entropy and matches it while sources
+   are fewer than the bins.
+*/
+
+/* same share as the per-worker hot-IP check */
+#define TALKER_HOT_SHARE  0.4
+/* normalized global entropy below this votes "concentrated" */
+#define TALKER_LOW_EVENNESS 0.8
+#define TALKER_REPORT      10
+
+static MPI_Datatype entry_type = MPI_DATATYPE_NULL;
+static MPI_Datatype summary_type = MPI_DATATYPE_NULL;
+static MPI_Op merge_op = MPI_OP_NULL;
+
+void talkers_init(TalkerSummary *t)
+{
+    memset(t, 0, sizeof(TalkerSummary));
+}
+
+static uint32_t talker_bucket(const char *ip)
+{
+    /* FNV-1a over the address string: identical on every rank */
+    uint32_t h = 2166136261u;
+    for (const char *p = ip; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 16777619u;
+    }
+    return h % TALKER_BUCKETS;
+}
+
+static int by_packets_desc(const void *a, const void *b)
+{
+    const TalkerEntry *x = a;
+    const TalkerEntry *y = b;
+    if (x->packets != y->packets) {
+        return x->packets < y->packets ? 1 : -1;
+    }
+    return x->ip < y->ip ? -1 : (x->ip > y->ip);
+}
+
+/* `b` into `a`: sums counts, keeps the heaviest TALKER_SLOTS sources */
+static void talkers_merge(TalkerSummary *a, const TalkerSummary *b)
+{
+    TalkerEntry all[2 * TALKER_SLOTS];
+    int n = 0;
+
+    for (int i = 0; i < a->count; i++) {
+        all[n] = a->entries[i];
+        all[n].error += b->floor;   /* corrected below if b lists it */
+        n++;
+    }
+    for (int j = 0; j < b->count; j++) {
+        const TalkerEntry *e = &b->entries[j];
+        int found = 0;
+        for (int i = 0; i < a->count; i++) {
+            if (all[i].ip == e->ip) {
+                all[i].packets += e->packets;
+                all[i].bytes   += e->bytes;
+                all[i].error   += e->error - b->floor;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            all[n] = *e;
+            all[n].error += a->floor;
+            n++;
+        }
+    }
+
+    qsort(all, n, sizeof(TalkerEntry), by_packets_desc);
+
+    int64_t floor = a->floor + b->floor;
+    int keep = n < TALKER_SLOTS ? n : TALKER_SLOTS;
+    for (int i = keep; i < n; i++) {
+        if (all[i].packets + all[i].error > floor) {
+            floor = all[i].packets + all[i].error;
+        }
+    }
+
+    memcpy(a->entries, all, sizeof(TalkerEntry) * keep);
+    a->count = keep;
+    a->floor = floor;
+    a->total_packets += b->total_packets;
+    a->total_bytes   += b->total_bytes;
+    for (int k = 0; k < TALKER_BUCKETS; k++) {
+        a->buckets[k] += b->buckets[k];
+    }
+}
+
+/* adds one window's exact per-IP stats to the summary */
+void talkers_add_stats(TalkerSummary *t, const IpStat *stats, int stat_count)
+{
+    TalkerSummary *local = malloc(sizeof(TalkerSummary));
+    TalkerEntry *all = malloc(sizeof(TalkerEntry) * (stat_count + 1));
+    if (!local || !all) {
+        fprintf(stderr, "Talkers: allocation failed\n");
+        free(local);
+        free(all);
+        return;
+    }
+    talkers_init(local);
+
+    int n = 0;
+    for (int i = 0; i < stat_count; i++) {
+        local->total_packets += stats[i].packet_count;
+        local->total_bytes   += stats[i].byte_count;
+        local->buckets[talker_bucket(stats[i].ip)] += stats[i].packet_count;
+
+        uint32_t ip;
+        if (ip_to_u32(stats[i].ip, &ip) != 0) {
+            continue;           /* non-IPv4: counted in totals and bins only */
+        }
+        all[n].ip      = ip;
+        all[n].packets = stats[i].packet_count;
+        all[n].bytes   = stats[i].byte_count;
+        all[n].error   = 0;
+        n++;
+    }
+
+    qsort(all, n, sizeof(TalkerEntry), by_packets_desc);
+    local->count = n < TALKER_SLOTS ? n : TALKER_SLOTS;
+    memcpy(local->entries, all, sizeof(TalkerEntry) * local->count);
+    if (n > TALKER_SLOTS) {
+        local->floor = all[TALKER_SLOTS].packets;
+    }
+
+    talkers_merge(t, local);
+    free(all);
+    free(local);
+}
+
+double talkers_entropy(const TalkerSummary *t)
+{
+    if (t->total_packets <= 0) {
+        return 0.0;
+    }
+    double entropy = 0.0;
+    for (int k = 0; k < TALKER_BUCKETS; k++) {
+        if (t->buckets[k] > 0) {
+            double p = (double)t->buckets[k] / (double)t->total_packets;
+            entropy += -p * log2(p);
+        }
+    }
+    return entropy;
+}
+
+static void talkers_reduce_op(void *in, void *inout, int *len,
+                              MPI_Datatype *type)
+{
+    (void)type;
+    TalkerSummary *src = in;
+    TalkerSummary *dst = inout;
+    for (int i = 0; i < *len; i++) {
+        talkers_merge(&dst[i], &src[i]);
+    }
+}
+
+void talkers_mpi_init(void)
+{
+    if (summary_type != MPI_DATATYPE_NULL) {
+        return;
+    }
+
+    MPI_Datatype tmp;
+    int entry_lengths[2] = { 1, 3 };
+    MPI_Aint entry_disps[2] = {
+        offsetof(TalkerEntry, ip),
+        offsetof(TalkerEntry, packets)
+    };
+    MPI_Datatype entry_types[2] = { MPI_UINT32_T, MPI_INT64_T };
+    MPI_Type_create_struct(2, entry_lengths, entry_disps, entry_types, &tmp);
+    MPI_Type_create_resized(tmp, 0, sizeof(TalkerEntry), &entry_type);
+    MPI_Type_free(&tmp);
+    MPI_Type_commit(&entry_type);
+
+    int lengths[4] = { 3, 1, TALKER_SLOTS, TALKER_BUCKETS };
+    MPI_Aint disps[4] = {
+        offsetof(TalkerSummary, total_packets),
+        offsetof(TalkerSummary, count),
+        offsetof(TalkerSummary, entries),
+        offsetof(TalkerSummary, buckets)
+    };
+    MPI_Datatype types[4] = {
+        MPI_INT64_T, MPI_INT32_T, entry_type, MPI_INT64_T
+    };
+    MPI_Type_create_struct(4, lengths, disps, types, &tmp);
+    MPI_Type_create_resized(tmp, 0, sizeof(TalkerSummary), &summary_type);
+    MPI_Type_free(&tmp);
+    MPI_Type_commit(&summary_type);
+
+    MPI_Op_create(talkers_reduce_op, 1, &merge_op);
+}
+
+void talkers_mpi_free(void)
+{
+    if (summary_type != MPI_DATATYPE_NULL) {
+        MPI_Op_free(&merge_op);
+        MPI_Type_free(&summary_type);
+        MPI_Type_free(&entry_type);
+    }
+}
+
+/*
+   Collective over MPI_COMM_WORLD: every rank contributes `local`, rank 0
+   receives the merged summary in `global` (ignored elsewhere).
+*/
+void talkers_reduce(const TalkerSummary *local, TalkerSummary *global)
+{
+    MPI_Reduce(local, global, 1, summary_type, merge_op, 0, MPI_COMM_WORLD);
+}
+
+/*
+   Global entropy over log2 of the occupied bins: 1.0 for perfectly even
+   sources, towards 0 as one source dominates.  A single occupied bin
+   counts as fully concentrated, like detect_entropy_anomaly.
+*/
+static double talkers_evenness(const TalkerSummary *t, double entropy)
+{
+    int occupied = 0;
+    for (int k = 0; k < TALKER_BUCKETS; k++) {
+        if (t->buckets[k] > 0) {
+            occupied++;
+        }
+    }
+    if (occupied <= 1) {
+        return 0.0;
+    }
+    return entropy / log2((double)occupied);
+}
+
+/*
+   Prints the global top talkers and entropy.  The global checks vote
+   like the window detectors: a source's share reaching
+   TALKER_HOT_SHARE is one vote, a global evenness below
+   TALKER_LOW_EVENNESS is another, and sources with VOTE_THRESHOLD
+   votes are written to `hot` (at most max_hot).  Returns how many.
+*/
+int talkers_report(const TalkerSummary *global, char (*hot)[IP_STR_LEN],
+                   int max_hot)
+{
+    int hot_count = 0;
+    double entropy = talkers_entropy(global);
+    double evenness = talkers_evenness(global, entropy);
+    int concentrated = (evenness < TALKER_LOW_EVENNESS);
+
+    printf("\n[COORDINATOR] Global top talkers (%lld packets, entropy %.3f, "
+           "evenness %.2f)\n", (long long)global->total_packets, entropy,
+           evenness);
+    if (global->total_packets <= 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < global->count; i++) {
+        const TalkerEntry *e = &global->entries[i];
+        double share = (double)e->packets / (double)global->total_packets;
+        char ip[IP_STR_LEN];
+        ip_from_u32(e->ip, ip);
+
+        if (i < TALKER_REPORT) {
+            printf("  %-16s %10lld pkts %12lld bytes  %5.1f%%  %s\n",
+                   ip, (long long)e->packets, (long long)e->bytes,
+                   share * 100.0, e->error == 0 ? "exact" : "lower bound");
+        }
+        if (share < TALKER_HOT_SHARE) {
+            continue;       /* only the share vote names a source */
+        }
+        if (1 + concentrated < VOTE_THRESHOLD) {
+            printf("  %s holds %.1f%% but sources are even; not blocked\n",
+                   ip, share * 100.0);
+        } else if (hot_count < max_hot) {
+            strcpy(hot[hot_count++], ip);
+        }
+    }
+    if (global->floor > 0) {
+        printf("  unlisted sources: at most %lld pkts each\n",
+               (long long)global->floor);
+    }
+    return hot_count;
+}
+
+/*
+   Moves the listed sources whose ring key lies in (lo, hi] out of `t`
+   into `moved`, with their share of the totals and entropy bins.
+   Unlisted sources of the range stay behind in the bins and floor.
+*/
+void talkers_split_range(TalkerSummary *t, uint32_t lo, uint32_t hi,
+                         TalkerSummary *moved)
+{
+    talkers_init(moved);
+
+    int kept = 0;
+    for (int i = 0; i < t->count; i++) {
+        TalkerEntry *e = &t->entries[i];
+        if (!ring_in_range(ring_key(e->ip), lo, hi)) {
+            t->entries[kept++] = *e;
+            continue;
+        }
+        char ip[IP_STR_LEN];
+        ip_from_u32(e->ip, ip);
+        uint32_t bucket = talker_bucket(ip);
+
+        moved->entries[moved->count++] = *e;
+        moved->total_packets += e->packets;
+        moved->total_bytes   += e->bytes;
+        moved->buckets[bucket] += e->packets;
+        t->total_packets -= e->packets;
+        t->total_bytes   -= e->bytes;
+        t->buckets[bucket] -= e->packets;
+    }
+    t->count = kept;
+}
+
+void talkers_isend(const TalkerSummary *t, int dest, int tag,
+                   MPI_Request *req)
+{
+    MPI_Isend(t, 1, summary_type, dest, tag, MPI_COMM_WORLD, req);
+}
+
+/* receives one summary from `source` and merges it into `t` */
+void talkers_recv_merge(TalkerSummary *t, int source, int tag)
+{
+    TalkerSummary *in = malloc(sizeof(TalkerSummary));
+    if (!in) {
+        fprintf(stderr, "Talkers: allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Recv(in, 1, summary_type, source, tag, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    talkers_merge(t, in);
+    free(in);
+}
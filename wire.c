@@ -0,0 +1,320 @@
+#include <mpi.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "detector.h"
+
+/* ==============================
+   Alert wire format
+   ============================== */
+/*
+   An Alert travels as one MPI_PACKED message:
+
+   AlertWire                      fixed header, MPI struct datatype
+   SuspectWire x suspect_count    variable-length suspect list
+   char[IP_STR_LEN] x text IPs    addresses that are not IPv4, if any
+
+   IPs are binary IPv4 (0 = none), detector flags are one bitmask of
+   DET_*_BIT, and every field has an explicit width, so MPI converts
+   the message correctly between heterogeneous nodes.  The header is
+   96 bytes and each suspect 24, against sizeof(Alert) for the raw
+   MPI_BYTE copy with its IP strings and padding.
+
+   An address that does not parse as IPv4 (IPv6, or a malformed field)
+   travels as its string instead: its bit in text_ips is set (bit 0 for
+   suspicious_ip, bit 1 + i for suspect i) and the strings follow the
+   suspect list in that order.
+
+   alert_send and alert_recv pack into one buffer each, sized once in
+   wire_init.  Only one thread per rank sends or receives alerts (the
+   comm thread under --threaded), so the buffers are not shared.
+*/
+
+typedef struct {
+    int32_t  worker_rank;
+    int32_t  window_id;
+    int32_t  attack_flag;
+    int32_t  detected;          /* DET_MASK() bits that voted attack */
+    int32_t  total_packets;
+    int32_t  total_flows;
+    int32_t  true_label;
+    int32_t  suspect_count;
+    int32_t  attack_votes;
+    int32_t  worker_count;
+    uint32_t suspicious_ip;
+    uint32_t text_ips;          /* addresses sent as strings, see above */
+    double   entropy;
+    double   avg_rate;
+    double   spike_score;
+    double   shift_score;
+    double   processing_time_ms;
+    int64_t  memory_used_kb;
+} AlertWire;
+
+typedef struct {
+    uint32_t ip;
+    int32_t  reports;
+    int64_t  packets;
+    int64_t  bytes;
+} SuspectWire;
+
+static MPI_Datatype alert_type = MPI_DATATYPE_NULL;
+static MPI_Datatype suspect_type = MPI_DATATYPE_NULL;
+static int max_bytes = 0;
+static char *send_buf = NULL;
+static char *recv_buf = NULL;
+
+static void commit_struct(int count, const int *lengths, const MPI_Aint *disps,
+                          const MPI_Datatype *types, MPI_Aint extent,
+                          MPI_Datatype *out)
+{
+    MPI_Datatype tmp;
+    MPI_Type_create_struct(count, lengths, disps, types, &tmp);
+    MPI_Type_create_resized(tmp, 0, extent, out);
+    MPI_Type_free(&tmp);
+    MPI_Type_commit(out);
+}
+
+void wire_init(void)
+{
+    if (alert_type != MPI_DATATYPE_NULL) {
+        return;
+    }
+
+    int alert_lengths[4] = { 10, 2, 5, 1 };
+    MPI_Aint alert_disps[4] = {
+        offsetof(AlertWire, worker_rank),
+        offsetof(AlertWire, suspicious_ip),
+        offsetof(AlertWire, entropy),
+        offsetof(AlertWire, memory_used_kb)
+    };
+    MPI_Datatype alert_types[4] = {
+        MPI_INT32_T, MPI_UINT32_T, MPI_DOUBLE, MPI_INT64_T
+    };
+    commit_struct(4, alert_lengths, alert_disps, alert_types,
+                  sizeof(AlertWire), &alert_type);
+
+    int suspect_lengths[3] = { 1, 1, 2 };
+    MPI_Aint suspect_disps[3] = {
+        offsetof(SuspectWire, ip),
+        offsetof(SuspectWire, reports),
+        offsetof(SuspectWire, packets)
+    };
+    MPI_Datatype suspect_types[3] = { MPI_UINT32_T, MPI_INT32_T, MPI_INT64_T };
+    commit_struct(3, suspect_lengths, suspect_disps, suspect_types,
+                  sizeof(SuspectWire), &suspect_type);
+
+    int header = 0, list = 0, text = 0;
+    MPI_Pack_size(1, alert_type, MPI_COMM_WORLD, &header);
+    MPI_Pack_size(MAX_SUSPECTS, suspect_type, MPI_COMM_WORLD, &list);
+    MPI_Pack_size((1 + MAX_SUSPECTS) * IP_STR_LEN, MPI_CHAR, MPI_COMM_WORLD,
+                  &text);
+    max_bytes = header + list + text;
+
+    send_buf = malloc(max_bytes);
+    recv_buf = malloc(max_bytes);
+    if (!send_buf || !recv_buf) {
+        fprintf(stderr, "Wire: buffer allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+void wire_free(void)
+{
+    if (alert_type != MPI_DATATYPE_NULL) {
+        MPI_Type_free(&alert_type);
+        MPI_Type_free(&suspect_type);
+    }
+    free(send_buf);
+    free(recv_buf);
+    send_buf = recv_buf = NULL;
+    max_bytes = 0;
+}
+
+/* upper bound of a packed alert, for receive buffers */
+int wire_max_bytes(void)
+{
+    return max_bytes;
+}
+
+/* dotted-quad IPv4 to host-order integer; 0 and -1 on anything else */
+int ip_to_u32(const char *ip, uint32_t *out)
+{
+    unsigned a, b, c, d;
+    char tail;
+
+    *out = 0;
+    if (sscanf(ip, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 ||
+        a > 255 || b > 255 || c > 255 || d > 255) {
+        return -1;
+    }
+    *out = (a << 24) | (b << 16) | (c << 8) | d;
+    return 0;
+}
+
+void ip_from_u32(uint32_t ip, char *out)
+{
+    if (ip == 0) {
+        strcpy(out, "NONE");
+        return;
+    }
+    snprintf(out, IP_STR_LEN, "%u.%u.%u.%u",
+             (unsigned)(ip >> 24) & 255, (unsigned)(ip >> 16) & 255,
+             (unsigned)(ip >> 8) & 255, (unsigned)ip & 255);
+}
+
+/*
+   Binary form of one alert address.  Returns 1 if it has to travel as
+   a string: set, not "NONE", and not IPv4.
+*/
+static int wire_ip(const char *ip, uint32_t *out)
+{
+    if (ip_to_u32(ip, out) == 0) {
+        return 0;
+    }
+    return ip[0] != '\0' && strcmp(ip, "NONE") != 0;
+}
+
+/* packs `alert` into `buf`; returns the packed size in bytes */
+int alert_pack(const Alert *alert, void *buf, int size)
+{
+    AlertWire w;
+    SuspectWire s[MAX_SUSPECTS];
+    char text[1 + MAX_SUSPECTS][IP_STR_LEN];
+    int texts = 0;
+    int count = alert->suspect_count;
+    if (count < 0) count = 0;
+    if (count > MAX_SUSPECTS) count = MAX_SUSPECTS;
+
+    memset(&w, 0, sizeof(AlertWire));
+    w.worker_rank   = alert->worker_rank;
+    w.window_id     = alert->window_id;
+    w.attack_flag   = alert->attack_flag;
+#define X(ID, name) if (alert->name##_detected) w.detected |= DET_MASK(ID);
+    DETECTOR_LIST(X)
+#undef X
+    w.total_packets = alert->total_packets;
+    w.total_flows   = alert->total_flows;
+    w.true_label    = alert->true_label;
+    w.suspect_count = count;
+    w.attack_votes  = alert->attack_votes;
+    w.worker_count  = alert->worker_count;
+    if (wire_ip(alert->suspicious_ip, &w.suspicious_ip)) {
+        w.text_ips |= 1u;
+        strncpy(text[texts], alert->suspicious_ip, IP_STR_LEN);
+        text[texts++][IP_STR_LEN - 1] = '\0';
+    }
+    w.entropy       = alert->entropy;
+    w.avg_rate      = alert->avg_rate;
+    w.spike_score   = alert->spike_score;
+    w.shift_score   = alert->shift_score;
+    w.processing_time_ms = alert->processing_time_ms;
+    w.memory_used_kb = alert->memory_used_kb;
+
+    for (int i = 0; i < count; i++) {
+        if (wire_ip(alert->suspects[i].ip, &s[i].ip)) {
+            w.text_ips |= 1u << (1 + i);
+            strncpy(text[texts], alert->suspects[i].ip, IP_STR_LEN);
+            text[texts++][IP_STR_LEN - 1] = '\0';
+        }
+        s[i].reports = alert->suspects[i].reports;
+        s[i].packets = alert->suspects[i].packets;
+        s[i].bytes   = alert->suspects[i].bytes;
+    }
+
+    int position = 0;
+    MPI_Pack(&w, 1, alert_type, buf, size, &position, MPI_COMM_WORLD);
+    if (count > 0) {
+        MPI_Pack(s, count, suspect_type, buf, size, &position,
+                 MPI_COMM_WORLD);
+    }
+    if (texts > 0) {
+        MPI_Pack(text, texts * IP_STR_LEN, MPI_CHAR, buf, size, &position,
+                 MPI_COMM_WORLD);
+    }
+    return position;
+}
+
+void alert_unpack(const void *buf, int bytes, Alert *alert)
+{
+    AlertWire w;
+    SuspectWire s[MAX_SUSPECTS];
+    char text[1 + MAX_SUSPECTS][IP_STR_LEN];
+    int position = 0;
+
+    MPI_Unpack(buf, bytes, &position, &w, 1, alert_type, MPI_COMM_WORLD);
+    int count = w.suspect_count;
+    if (count < 0) count = 0;
+    if (count > MAX_SUSPECTS) count = MAX_SUSPECTS;
+    if (count > 0) {
+        MPI_Unpack(buf, bytes, &position, s, count, suspect_type,
+                   MPI_COMM_WORLD);
+    }
+    int texts = 0;
+    for (int i = 0; i <= count; i++) {
+        if (w.text_ips & (1u << i)) texts++;
+    }
+    if (texts > 0) {
+        MPI_Unpack(buf, bytes, &position, text, texts * IP_STR_LEN, MPI_CHAR,
+                   MPI_COMM_WORLD);
+    }
+    int next_text = 0;
+
+    memset(alert, 0, sizeof(Alert));
+    alert->worker_rank   = w.worker_rank;
+    alert->window_id     = w.window_id;
+    alert->attack_flag   = w.attack_flag;
+#define X(ID, name) alert->name##_detected = (w.detected & DET_MASK(ID)) != 0;
+    DETECTOR_LIST(X)
+#undef X
+    alert->total_packets = w.total_packets;
+    alert->total_flows   = w.total_flows;
+    alert->true_label    = w.true_label;
+    alert->attack_votes  = w.attack_votes;
+    alert->worker_count  = w.worker_count;
+    if (w.text_ips & 1u) {
+        memcpy(alert->suspicious_ip, text[next_text++], IP_STR_LEN);
+        alert->suspicious_ip[IP_STR_LEN - 1] = '\0';
+    } else {
+        ip_from_u32(w.suspicious_ip, alert->suspicious_ip);
+    }
+    alert->entropy       = w.entropy;
+    alert->avg_rate      = w.avg_rate;
+    alert->spike_score   = w.spike_score;
+    alert->shift_score   = w.shift_score;
+    alert->processing_time_ms = w.processing_time_ms;
+    alert->memory_used_kb = (long)w.memory_used_kb;
+
+    alert->suspect_count = count;
+    for (int i = 0; i < count; i++) {
+        if (w.text_ips & (1u << (1 + i))) {
+            memcpy(alert->suspects[i].ip, text[next_text++], IP_STR_LEN);
+            alert->suspects[i].ip[IP_STR_LEN - 1] = '\0';
+        } else {
+            ip_from_u32(s[i].ip, alert->suspects[i].ip);
+        }
+        alert->suspects[i].reports = s[i].reports;
+        alert->suspects[i].packets = (long)s[i].packets;
+        alert->suspects[i].bytes   = (long)s[i].bytes;
+    }
+}
+
+void alert_send(const Alert *alert, int dest, int tag)
+{
+    int bytes = alert_pack(alert, send_buf, max_bytes);
+    MPI_Send(send_buf, bytes, MPI_PACKED, dest, tag, MPI_COMM_WORLD);
+}
+
+void alert_recv(Alert *alert, int source, int tag, MPI_Status *status)
+{
+    MPI_Status local;
+    if (status == MPI_STATUS_IGNORE) {
+        status = &local;
+    }
+    int bytes = 0;
+    MPI_Recv(recv_buf, max_bytes, MPI_PACKED, source, tag, MPI_COMM_WORLD,
+             status);
+    MPI_Get_count(status, MPI_PACKED, &bytes);
+    alert_unpack(recv_buf, bytes, alert);
+}